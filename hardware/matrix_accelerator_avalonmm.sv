@@ -1,64 +1,561 @@
-//This module takes the 16 bit input of two 4*4 matrix A and B, and performs sum (A + B), difference (A − B) and prduct, 
+//This module takes the 16 bit input of two N*N matrix A and B (N = 4 by default), and performs sum (A + B), difference (A − B) and prduct, 
 //and stores them in the separate 32 bit output matrices SUM, DIFF and PROD respectively.
-//Each element of the 16 matrix product outputs has its own multiply accumulate unit, 
-//so the entire 4×4 product is computed in four clock cycles, one clock cycle per single product; total of 4 product
-//2.In the same start pulse, the hardware also computes SUM[i] = A[i] + B[i] and DIFF[i] = A[i] − B[i] for all 16 elements; 
-//these operations are completed before the first product cycle begins. 
+//Each element of the N*N matrix product outputs has its own multiply accumulate unit, 
+//so the entire N×N product is computed in N clock cycles, one clock cycle per k term (e.g. four cycles for the 4×4 product at N = 4)
+//2.In the same start pulse, the hardware also computes SUM[i] = A[i] + B[i] and DIFF[i] = A[i] − B[i] for all N*N elements (16 at N = 4); 
+//these operations are completed in the first product cycle (k = 0), together with the first partial products. 
 
-// Register map (word addresses):
+// Register map (word addresses, listed for N = 4):
 //     0–15 : A[0..15]     – first input matrix A (write only)
 //      16–31 : B[0..15]   – second input matrix B (write‑only)
 //      32–47 : SUM[0..15] – element‑wise sum (A+B) (read‑only)
 //    48–63 : DIFF[0..15]  – element‑wise difference (A−B)( to read only))
 //      64–79 : PROD[0..15]– matrix product C = A×B (read only)
-//     80 : CONTROL        – bit0 = START (for the write only)
-//     81 : STATUS         - bit0 = DONE, bit1 = BUSY (to read these two LSB only)
+//     80 : CONTROL        – bit0 = START, bit1 = DMA, bit2 = RUN_BANK, bit3 = HOST_BANK,
+//                           bit4 = OP_ADD, bit5 = OP_SUB, bit6 = OP_MUL, bit7 = ACCUM, bit8 = CLEAR_ACC (for the write only),
+//                           bit9 = REUSE_B, bit12..10 = CHAIN (0 = none, 1 = ADD_C, 2 = FEED, 3 = ABC),
+//                           bit13 = TRANS_A, bit14 = TRANS_B
+//     81 : STATUS         - bit0 = DONE, bit1 = BUSY, bit2 = DONE_BANK0, bit3 = DONE_BANK1,
+//                           bit4 = B_VALID0, bit5 = B_VALID1, bit6 = JOBQ_OVERFLOW, bit7 = PROD_OVF,
+//                           bit10..8 = JOBQ_IN_COUNT, bit14..12 = JOBQ_OUT_COUNT (read only)
+//     82 : IRQ            – bit0 = IRQ_ENABLE (read/write), bit1 = IRQ_PENDING (read, write 1 to clear)
+//     83 : MODE           – bit0 = STREAM_EN, bit3..1 = STREAM_OPS (0 = all), bit4 = STREAM_REUSE_B,
+//                           bit8 = INT8, bit9 = SAT_PROD, bit10 = RES_INTERLEAVE, bit11 = ZERO_SKIP,
+//                           bit12 = C_SELECT, bit20..16 = CHAIN_SHIFT (read/write)
+//     84 : DMA_SRC_A      – byte address of A in memory, 16 int16 row-major, 4-byte aligned (read/write)
+//     85 : DMA_SRC_B      – byte address of B in memory, same layout as A (read/write)
+//     86 : DMA_DST        – byte address of the 48-word result block SUM[16], DIFF[16], PROD[16] (read/write)
+//     87 : BATCH_COUNT    – number of matrix pairs one DMA START works through, 0 counts as 1 (read/write)
+//     88 : BATCH_DONE     – number of pairs of the current/last batch already written back (read only)
+//     89 : JOBQ           – write: bit0 = POP (drop the result queue head), bit1 = FLUSH (empty both queues,
+//                           clear JOBQ_OVERFLOW); read: bit7..0 = queue depth
+//     90 : SKIP_LAST      – MAC cycles the last finished job skipped with ZERO_SKIP (read only)
+//     91 : SKIP_TOTAL     – MAC cycles skipped since reset or the last write to it (read, write clears)
+//     92 : ROW_VALID      – bit3..0 = rows of A, bit19..16 = rows of B that hold data, the others are
+//                           taken as zero by slave STARTs (read/write, all rows valid after reset)
+//     93 : DMA_STRIDE_A   – bytes from one row of A to the next in memory, 0 = dense rows (read/write)
+//     94 : DMA_STRIDE_B   – same for B (read/write)
+//     95 : DMA_STEP       – bit1..0 = A, bit3..2 = B: where the next pair of a batch starts, 0 = NEXT,
+//                           1 = RIGHT, 2 = DOWN (read/write)
+//    96–103 : A_PACKED[0..7] – matrix A, two elements per word (write only)
+//   104–111 : B_PACKED[0..7] – matrix B, two elements per word (write only)
+//              word w carries element 2w in [15:0] and element 2w+1 in [31:16]
+//              (same layout as a little-endian int16_t array read as uint32_t)
+//   112–127 : JOBQ_IN[0..15]  – next job queue entry: 8 A_PACKED words then 8 B_PACKED words (write only)
+//   128–175 : JOBQ_OUT[0..47] – result queue head: SUM[16], DIFF[16], PROD[16] (read only)
+//   176–191 : PROD_HI[0..15]  – upper 32 bits of the 64-bit products (read only)
+//       192 : PROD_OVF_MASK   – bit i set: PROD[i] does not fit in 32 bits (read only)
+//   193–203 : PERF[0..10]     – performance counters, see below (read only)
+//       204 : PERF_CTRL       – bit0 = CLEAR (write only), bit1 = FREEZE (read/write)
+//   205–252 : RESULT[0..47]   – the selected results of the host bank in one contiguous block (read only)
+//
+// Matrix size parameter N (even, e.g. 4, 8 or 16); with NN = N*N the map is generated as
+//   A: 0, B: NN, SUM: 2*NN, DIFF: 3*NN, PROD: 4*NN (NN words each),
+//   control/status registers: 5*NN + 0..15 (same order as above: CONTROL at 5*NN, STATUS at 5*NN+1, ...),
+//   A_PACKED: 5*NN + 16, B_PACKED: 5*NN + 16 + NN/2 (NN/2 words each),
+//   JOBQ_IN: 6*NN + 16 (NN words), JOBQ_OUT: 7*NN + 16 (3*NN words), PROD_HI: 10*NN + 16 (NN words),
+//   PROD_OVF_MASK: 11*NN + 16 ((NN+31)/32 words, element 32w+b in bit b of word w),
+//   PERF: right after the mask (12 words, PERF_CTRL is the last one), RESULT: right after PERF (3*NN words),
+// so N = 4 gives exactly the addresses above. The address port is 8 bits for N = 4 and grows with N
+// (ADDR_W), the DMA matrices are NN int16 (NN*2 bytes) and the DMA result blocks 3*NN words.
+// The multiplier count is NN (N*N*N with PARALLEL_MUL), so N = 8 uses 64 multipliers and N = 16
+// is larger than the DE1-SoC's DSP blocks; the software tiles bigger matrices onto the N×N unit.
 //
 // for using this accelerator from software:
-//1. Write the 16 elements of matrix A to addresses 0..15.
-//2. Write the 16 elements of matrix B to addresses 16..31.
+//1. Write the 16 elements of matrix A to addresses 0..15 (or 8 packed words to 96..103).
+//2. Write the 16 elements of matrix B to addresses 16..31 (or 8 packed words to 104..111).
 //3. Write 1 to address 80 to start the computation.
 //4. Poll address 81 until bit0 (DONE) is high and bit1 (BUSY) is low.
 //5. Read SUM (32..47), DIFF (48..63) and PROD (64..79) matrices.
 //
-module mat_mul_sub_add_all_parallel_16bit(
+// Double buffering (ping-pong): A, B, SUM, DIFF and PROD exist twice, in bank 0 and bank 1.
+// - the matrix windows (0..79, 96..111) always access the HOST_BANK given by the last CONTROL write
+// - START computes on the RUN_BANK given in the same CONTROL write, results land in that bank
+// - DONE_BANKn is cleared by a START on bank n and set when that job is finished
+// So while bank n computes, the software loads the next pair into bank 1-n and reads the previous
+// results from it; one CONTROL write (START | RUN_BANK = n | HOST_BANK = 1-n) starts a job and swaps banks.
+// A START written while a job is still running is held and starts right after it; writing 0 to
+// START does not cancel it. Software that never sets the bank bits only uses bank 0.
+//
+// Operation mask: OP_ADD/OP_SUB/OP_MUL written with START select which of SUM, DIFF and PROD the job
+// computes (all three bits 0 = all three, as before). Results of operations that are not selected keep
+// their old values. Without OP_MUL the job skips the four MAC cycles, and in DMA mode only the selected
+// 16-word parts of the result block are written back (the block layout stays the same).
+//
+// Accumulate in place (C += A×B): a START with ACCUM does not zero the 64-bit product accumulators, so
+// successive STARTs add up their products and PROD always shows the running total. CLEAR_ACC zeroes the
+// accumulators (before the START if both are written together; PROD keeps its value until the next job).
+// The accumulators are shared by both banks, so a K-deep tile chain can still ping-pong its operands.
+// In a DMA batch with ACCUM, the pairs are accumulated and only one result block, the total, is written
+// back to DMA_DST after the last pair, instead of one block per pair.
+//
+// Operand reuse (one B against many A): a START with REUSE_B computes with the B already held in
+// its run bank, so only A has to be loaded for each job. Over the slave this is just a matter of not
+// rewriting B (the windows keep their values); in DMA mode FETCH then reads only the NN/2 A words from
+// DMA_SRC_A, and every pair of a batch uses the same resident B (DMA_SRC_B is not read).
+// B_VALIDn is set once B of bank n has been written (by the host or by a DMA fetch) and stays set,
+// B_VALIDn = 0 means B of that bank still holds its reset value of zeros.
+//
+// Precision modes (MODE, taken over by every job when it starts):
+// - INT8: the operands are int8, packed four per word in the packed windows (A_PACKED word w carries
+//   elements 4w..4w+3 in bytes 0..3, only words 0..NN/4-1 are used, so 4 writes per matrix for N = 4),
+//   in DMA mode and on the stream sink the matrices are NN int8 (NN/4 words each, NN bytes apart in a batch);
+//   the MAC array does two k terms per cycle (the second one on a small 8×8 multiplier per element),
+//   so PROD takes N/2 MAC cycles instead of N. All operands of an INT8 job must be in -128..127
+//   (the per-element windows still take 16-bit values); JOBQ_IN stays int16, queued jobs ignore INT8.
+// - SAT_PROD: PROD is the 64-bit accumulator clamped to -2^31..2^31-1 instead of its low 32 bits,
+//   so inputs do not have to be limited to the safe range in software.
+//
+// 64-bit products: PROD holds the low 32 bits of each 64-bit accumulator (clamped with SAT_PROD) and
+// PROD_HI the upper 32 bits, written together. PROD_OVF_MASK marks the elements whose product does not
+// fit in an int32 and STATUS.PROD_OVF is their OR (both for the host bank, like the windows), so the
+// software only reads PROD_HI when PROD_OVF is set; it comes in the same STATUS read that sees DONE.
+// The DMA result blocks and JOBQ_OUT stay 32-bit per element.
+//
+// Performance counters (32 bits, free-running, wrap around), to see where the time of a job goes:
+//   PERF[0] LOAD_AB cycles   PERF[1] FETCH cycles   PERF[2] RUN cycles   PERF[3] WRITEBACK cycles
+//   PERF[4] DONE cycles      PERF[5] jobs started (STARTs, stream packets and queued jobs)
+//   PERF[6] slave read beats PERF[7] slave write beats (the host's bus traffic, including these reads)
+//   PERF[8] idle cycles: no job running or pending, counted from the first job after CLEAR
+//   PERF[9] DMA master reads PERF[10] DMA master writes
+// CLEAR zeroes all of them, FREEZE stops them so a consistent set can be read (e.g. in one burst).
+//
+// Zero skip (MODE.ZERO_SKIP): the k term A[.][k] * B[k][.] adds nothing when column k of A or row k of B
+// is all zero, so after the k = 0 cycle (which always runs: SUM/DIFF and the accumulator start) the MAC
+// array jumps straight to the next k with non-zero column and row, and to the copy cycle after the last one;
+// block-sparse inputs finish correspondingly earlier. SKIP_LAST/SKIP_TOTAL count the cycles saved.
+// It applies to int16 jobs without PARALLEL_MUL (INT8 and queued jobs always run all steps).
+// ROW_VALID lets the driver leave out the writes of all-zero rows: rows marked invalid read as zero
+// for the job (SUM/DIFF too), whatever the bank holds. It only applies to slave STARTs; DMA, stream and
+// queued jobs always use all their rows. A START latches it, so it can be rewritten for the next job
+// right after the START.
+//
+// Chained operations (no readback and reload between the steps of an expression):
+// Each bank also has a third operand matrix C. With MODE.C_SELECT set, the B and B_PACKED windows write C
+// of the host bank instead of B (int16 only; B and B_VALID are left alone). A START's CHAIN field selects
+// - ADD_C (1): PROD = A×B as usual, and the SUM/DIFF adders take PROD and C instead of A and B:
+//   SUM = A×B + C, DIFF = A×B − C (32-bit, after SAT_PROD if set), computed in the copy cycle
+// - FEED (2): PROD = A×B, and the product also replaces A of the bank, as the A of the next job:
+//   A = PROD >> CHAIN_SHIFT (arithmetic), saturated to int16 (the shift keeps fixed-point formats in scale)
+// - ABC (3): PROD = (A×B)×C in one START: the first pass feeds its scaled product into A like FEED, the
+//   second multiplies that by C (N + 1 more cycles); SUM/DIFF, if selected, are A + B and A − B of the
+//   original A, and PROD_HI/PROD_OVF describe the final product
+// Chained jobs always compute PROD and ignore ACCUM; CHAIN is ignored in INT8 mode and for stream and
+// queued jobs. E.g. a chain of 4×4 transforms T1·T2·T3·p is one ABC job (T1, T2, T3) then one
+// FEED/ADD_C job per further step, with only the new operand written each time.
+//
+// Transposed operands: TRANS_A/TRANS_B of a START make the job compute with A^T / B^T of the run bank,
+// the matrices are transposed at index time (element [r][c] is read from [c][r]), not moved, so
+// column-major data can be loaded (or fetched) as it is. SUM/DIFF use the transposed operands too, and
+// ROW_VALID still names the rows as loaded. They apply to slave and DMA STARTs, not to C, the fed-back A
+// of an ABC second pass, or stream and queued jobs.
+//
+// Strided DMA (tiles in place in a larger row-major matrix):
+// With DMA_STRIDE_A/B non-zero, row r of the A/B tile is fetched from (address + r × stride) instead of
+// (address + r × N×2) (N bytes per row in INT8 mode), so an N×N tile is read straight out of a big matrix.
+// Strides and addresses must be multiples of 4 (a tile column offset a multiple of 2 elements, 4 in INT8).
+// DMA_STEP says where the following pair of a batch starts, separately for A and B:
+//   NEXT (0):  the next dense matrix, NN elements on (the batch layout without strides)
+//   RIGHT (1): the tile to the right, N elements on
+//   DOWN (2):  the tile below, N rows of the stride on (= NEXT with stride 0)
+// e.g. an accumulating batch over k with A stepping RIGHT and B stepping DOWN is one block of a tiled
+// GEMM, read in place from both matrices. Strides and steps are read while the batch runs, change them
+// only while not BUSY. The result blocks are always dense.
+//
+// Result window: RESULT holds exactly the results the last job on the host bank computed (its op mask),
+// packed from word 0 with nothing in between, so one contiguous read of 16 × (number of selected operations)
+// words (bursts of up to 16; one DMA descriptor or one memcpy through the data cache, issued as several
+// bursts when more than one operation is selected) fetches all of them:
+// - planar (RES_INTERLEAVE = 0): the selected matrices one after the other, in the order SUM, DIFF, PROD,
+//   e.g. DIFF[0..15] then PROD[0..15] for OP_SUB | OP_MUL
+// - interleaved (RES_INTERLEAVE = 1): element by element, the selected results of element i together,
+//   e.g. SUM[0], DIFF[0], PROD[0], SUM[1], ... for all three
+// Words past the selected results read 0. The separate SUM/DIFF/PROD windows are unchanged.
+//
+// Build-time parameter PARALLEL_MUL:
+// 0 (default) – 16 MACs, one k term per cycle, PROD is ready after 4 MAC cycles + 1 copy cycle
+// 1           – all 64 16×16 products and an adder tree per element in one cycle, PROD is ready
+//               after 1 compute cycle + 1 copy cycle; costs 64 multipliers (32 of the 87 Cyclone V DSP
+//               blocks on the DE1-SoC, two 18×18 multipliers per block) instead of 16 (for N = 4)
+//
+// Build-time parameters for timing closure (hardware/quartus/build_variants.tcl compiles the variants):
+// PIPELINE_MAC = 1 – the multiplier outputs (full_dot with PARALLEL_MUL) go into a register (mul_q) and are
+//               added to the accumulators one cycle later, so the multiply and the 64-bit add are no longer
+//               in one cycle (the DSP blocks' output registers are used). The last product is added in the
+//               copy cycle, so slave, DMA and stream jobs take exactly as many cycles as before; queued jobs
+//               take N + 1 cycles instead of N (their result goes into the queue from the copy cycle).
+// ACC_W (default 64) – accumulator width. 32 + log2(N) bits (34 for N = 4) are exact for one product, wider
+//               ones are only needed for long ACCUM chains; narrower accumulators wrap around at ACC_W bits,
+//               PROD_HI and PROD_OVF are the sign extension of that. Must be 33..64.
+// The read mux in front of readdata is always registered (see the read logic at the end).
+//
+// Interrupt: IRQ_PENDING is set every time DONE goes high (end of a job, or of a whole batch in
+// batch mode); the irq output is IRQ_PENDING & IRQ_ENABLE and stays high until the ISR writes 1
+// to IRQ_PENDING, so the software can start a job and do other work instead of polling STATUS.
+//
+// DMA mode (no operand/result traffic through the CPU):
+//1. Write the memory addresses of A, B and the result block to DMA_SRC_A, DMA_SRC_B and DMA_DST.
+//2. Write 3 (START | DMA) to CONTROL.
+//3. The accelerator reads A and B over its own Avalon-MM master (8 packed words each), computes,
+//   writes SUM, DIFF and PROD to DMA_DST (48 words) and only then sets DONE.
+//   The result windows 32..79 hold the same results afterwards.
+//
+// Batch mode is DMA mode with BATCH_COUNT = n: DMA_SRC_A/DMA_SRC_B point to n consecutive matrices
+// (32 bytes apart) and DMA_DST to n consecutive result blocks (192 bytes apart). The pairs are
+// fetched, computed and written back one after the other, DONE is set once after the last one
+// (DONE doubles as the batch-complete flag, BATCH_DONE shows the progress while BUSY).
+//
+// Streaming (Avalon-ST): with STREAM_EN set in MODE, the accelerator also takes jobs from its sink
+// and sends the results out of its source, with no CPU involved:
+// - operand packet on the sink: NN packed words (8 for N = 4), the A_PACKED words then the B_PACKED
+//   words, same packing as the windows; with STREAM_REUSE_B only the NN/2 A words, B stays resident
+// - result packet on the source: the 16-word matrices selected by STREAM_OPS, in the order SUM, DIFF,
+//   PROD (48 words for all three), startofpacket on the first and endofpacket on the last word
+// - a beat with startofpacket always goes to word 0, so a short packet cannot shift the next ones;
+//   endofpacket on the sink is not needed (the length is fixed)
+// - backpressure both ways: the sink is only ready while a packet is being taken in, and the source
+//   holds each word until aso_ready
+// Stream jobs run on bank 0 and only when no MM START is pending (a START always goes first); they
+// set BUSY but not DONE or the interrupt, so the MM side can still use bank 1 in the meantime.
+// Without backpressure a stream job takes NN/2 (or NN) operand + N + 1 compute + result-word cycles,
+// plus 2 cycles between jobs, e.g. 8 + 5 + 16 + 2 = 31 cycles for a PROD-only stream with REUSE_B at N = 4.
+//
+// Job queue (several jobs in flight): the host pushes jobs into an input queue and pops finished
+// result sets from a result queue, both JQ_DEPTH (4) entries deep:
+// - write the NN packed words of a pair to JOBQ_IN (one 16-word burst for N = 4), the write of the
+//   last word pushes the entry; writes while JOBQ_IN_COUNT = 4 are dropped and set JOBQ_OVERFLOW
+// - while the result queue has room, queued jobs run back to back straight from the queue entries:
+//   the MAC array takes a new entry on the cycle after the last k term of the previous one, so the
+//   steady state is one 4×4 product (with SUM and DIFF) every N = 4 cycles (every cycle with PARALLEL_MUL)
+// - read the head result set from JOBQ_OUT while JOBQ_OUT_COUNT > 0, then write POP to JOBQ
+// Queued jobs always compute all three results, use the product accumulators (so they must not be mixed
+// into an ACCUM chain) and do not touch the banks, DONE or the interrupt; a pending START or stream
+// job goes first, the queue continues after it. FLUSH is ignored while a queued job is running.
+//
+// Avalon-MM slave interface:
+// - pipelined reads with variable latency: readdata is registered and qualified by readdatavalid,
+//   one cycle after the read is accepted, so a new read can be issued on every clock
+// - bursts up to 16 words (burstcount), the slave counts the burst address internally starting
+//   at 'address', so a whole 16-word window (or all of A_PACKED + B_PACKED) moves in one burst
+// - waitrequest is only asserted while a read burst is still returning data
+// - byteenable is honoured for the A/B element writes and for CONTROL
+// In Platform Designer the slave must be set up with readLatency = 0, maximumPendingReadTransactions = 1
+// (any value up to the burst length also works, as commands are stalled during a read burst),
+// maxBurstSize = 16 and burstOnBurstBoundariesOnly = false.
+//
+module mat_mul_sub_add_all_parallel_16bit #(
+    parameter int N = 4,               //matrix dimension, N×N (even, so the packed windows come out whole)
+    parameter bit PARALLEL_MUL = 1'b0, //1 = single-cycle fully parallel matrix multiply (N*N*N multipliers)
+    parameter bit PIPELINE_MAC = 1'b0, //1 = register the products before accumulating them (higher Fmax)
+    parameter int ACC_W = 64,          //accumulator width, 33..64 bits
+    //address width follows from the register map, do not override (8 bits for N = 4)
+    parameter int ADDR_W = ((14*N*N + 28 + (N*N + 31)/32) <= 256) ? 8 : $clog2(14*N*N + 28 + (N*N + 31)/32)
+)(
     input logic clk,
     input logic reset,
     input logic chipselect,
     input logic read,
     input logic write,
-    input logic [7:0] address,  //8 bit to cover addresses from (0..81); 256 addresses total
+    input logic [ADDR_W-1:0] address,  //word address, 8 bit for N = 4 to cover addresses from (0..252); 256 addresses total
     input logic [31:0] writedata,
-    output logic [31:0] readdata
+    input logic [3:0] byteenable,  //byte lanes of writedata
+    input logic [4:0] burstcount,  //1..16 words per burst
+    output logic waitrequest,
+    output logic readdatavalid,
+    output logic [31:0] readdata,
+
+    //Avalon-MM master used by DMA mode, single-word pipelined transfers
+    output logic [31:0] dma_address,  //byte address
+    output logic dma_read,
+    output logic dma_write,
+    output logic [31:0] dma_writedata,
+    output logic [3:0] dma_byteenable,
+    input logic [31:0] dma_readdata,
+    input logic dma_readdatavalid,
+    input logic dma_waitrequest,
+
+    //Interrupt sender, level sensitive
+    output logic irq,
+
+    //Avalon-ST sink, operand packets (ready latency 0)
+    input logic [31:0] asi_data,
+    input logic asi_valid,
+    output logic asi_ready,
+    input logic asi_startofpacket,
+    input logic asi_endofpacket,  //not needed, the packet length is fixed by MODE
+
+    //Avalon-ST source, result packets (ready latency 0)
+    output logic [31:0] aso_data,
+    output logic aso_valid,
+    input logic aso_ready,
+    output logic aso_startofpacket,
+    output logic aso_endofpacket
 );
 
+//mul16/mul8 for the MACs and sat32 for SAT_PROD, the same functions the custom instruction uses
+import matrix_mac_pkg::*;
+
+//Sizes derived from N
+localparam int NN = N*N;                 //elements per matrix
+localparam int HALF = NN/2;              //packed words per matrix
+localparam int QUARTER = NN/4;           //int8 packed words per matrix (INT8 mode)
+localparam int K_W = $clog2(N + 1);      //k counts 0..N
+localparam int IDX_W = $clog2(NN);       //element index
+localparam int CNT_W = $clog2(NN + 1);   //FETCH word counters, 0..NN
+
+//Register map, generated from N (the addresses in the comment at the top are for N = 4)
+localparam int A_BASE = 0;               //A[0..NN-1]
+localparam int B_BASE = NN;              //B[0..NN-1]
+localparam int SUM_BASE = 2*NN;          //SUM[0..NN-1]
+localparam int DIFF_BASE = 3*NN;         //DIFF[0..NN-1]
+localparam int PROD_BASE = 4*NN;         //PROD[0..NN-1]
+localparam int REG_BASE = 5*NN;          //16 control/status registers
+localparam int A_PACKED_BASE = REG_BASE + 16;     //A, two elements per word
+localparam int B_PACKED_BASE = A_PACKED_BASE + HALF; //B, two elements per word
+localparam int JOBQ_IN_BASE = B_PACKED_BASE + HALF;  //job queue entry being written, NN packed words
+localparam int JOBQ_OUT_BASE = JOBQ_IN_BASE + NN;    //result queue head, 3*NN words
+localparam int PROD_HI_BASE = JOBQ_OUT_BASE + 3*NN; //upper halves of the products
+localparam int PROD_OVF_BASE = PROD_HI_BASE + NN;   //per-element overflow mask
+localparam int OVF_WORDS = (NN + 31)/32;            //words of the mask
+localparam int PERF_BASE = PROD_OVF_BASE + OVF_WORDS; //performance counters
+localparam int PERF_WORDS = 12;                      //counters, then PERF_CTRL in the last word
+localparam int RES_BASE = PERF_BASE + PERF_WORDS;    //contiguous result window, 3*NN words
+localparam int MAP_END = RES_BASE + 3*NN;
+
+//Performance counter indices
+localparam int PERF_LOAD = 0;
+localparam int PERF_FETCH = 1;
+localparam int PERF_RUN = 2;
+localparam int PERF_WRITEBACK = 3;
+localparam int PERF_DONE = 4;
+localparam int PERF_JOBS = 5;
+localparam int PERF_BUS_READS = 6;
+localparam int PERF_BUS_WRITES = 7;
+localparam int PERF_IDLE = 8;
+localparam int PERF_DMA_READS = 9;
+localparam int PERF_DMA_WRITES = 10;
+localparam int PERF_COUNT = 11;
+
+//Job queue sizes
+localparam int JQ_DEPTH = 4;                 //entries per queue
+localparam int JQ_W = $clog2(JQ_DEPTH);      //queue pointer
+localparam int JQ_CW = $clog2(JQ_DEPTH + 1); //queue occupancy, 0..JQ_DEPTH
+
+localparam logic [ADDR_W-1:0] REG_CONTROL = ADDR_W'(REG_BASE + 0);
+localparam logic [ADDR_W-1:0] REG_STATUS = ADDR_W'(REG_BASE + 1);
+localparam logic [ADDR_W-1:0] REG_IRQ = ADDR_W'(REG_BASE + 2);
+localparam logic [ADDR_W-1:0] REG_MODE = ADDR_W'(REG_BASE + 3);
+localparam logic [ADDR_W-1:0] REG_DMA_SRC_A = ADDR_W'(REG_BASE + 4);
+localparam logic [ADDR_W-1:0] REG_DMA_SRC_B = ADDR_W'(REG_BASE + 5);
+localparam logic [ADDR_W-1:0] REG_DMA_DST = ADDR_W'(REG_BASE + 6);
+localparam logic [ADDR_W-1:0] REG_BATCH_COUNT = ADDR_W'(REG_BASE + 7);
+localparam logic [ADDR_W-1:0] REG_BATCH_DONE = ADDR_W'(REG_BASE + 8);
+localparam logic [ADDR_W-1:0] REG_JOBQ = ADDR_W'(REG_BASE + 9);
+localparam logic [ADDR_W-1:0] REG_SKIP_LAST = ADDR_W'(REG_BASE + 10);
+localparam logic [ADDR_W-1:0] REG_SKIP_TOTAL = ADDR_W'(REG_BASE + 11);
+localparam logic [ADDR_W-1:0] REG_ROW_VALID = ADDR_W'(REG_BASE + 12);
+localparam logic [ADDR_W-1:0] REG_DMA_STRIDE_A = ADDR_W'(REG_BASE + 13);
+localparam logic [ADDR_W-1:0] REG_DMA_STRIDE_B = ADDR_W'(REG_BASE + 14);
+localparam logic [ADDR_W-1:0] REG_DMA_STEP = ADDR_W'(REG_BASE + 15);
+
+//CONTROL.CHAIN opcodes
+localparam logic [2:0] CHAIN_NONE = 3'd0;
+localparam logic [2:0] CHAIN_ADD_C = 3'd1;  //SUM/DIFF = PROD ± C
+localparam logic [2:0] CHAIN_FEED = 3'd2;   //A = PROD (scaled) for the next job
+localparam logic [2:0] CHAIN_ABC = 3'd3;    //PROD = (A×B)×C
+
+//DMA_STEP values
+localparam logic [1:0] STEP_NEXT = 2'd0;
+localparam logic [1:0] STEP_RIGHT = 2'd1;
+localparam logic [1:0] STEP_DOWN = 2'd2;
+
 //Control and status signals
 logic start_bit;//start pulse from software
 logic busy_bit;    //high while any computation is in progress
 logic done_bit;    //high when all results are ready
+logic dma_bit;     //START requested with DMA, latched with start_bit
+logic dma_job;     //the job in progress fetches operands and writes results over the DMA master
+logic start_bank;  //RUN_BANK of the pending START
+logic run_bank;    //bank the job in progress reads operands from and writes results to
+logic host_bank;   //bank the slave windows access
+logic [1:0] done_bank; //per-bank DONE
+logic [2:0] start_ops; //operation mask of the pending START, bit0 = ADD, bit1 = SUB, bit2 = MUL
+logic [2:0] run_ops;   //operation mask of the job in progress
+logic start_accum; //ACCUM of the pending START
+logic run_accum;   //the job in progress adds to the accumulators instead of starting from zero
+logic clear_acc;   //CLEAR_ACC written, done as soon as no job is running
+logic start_reuse_b; //REUSE_B of the pending START
+logic [2:0] start_chain; //CHAIN of the pending START
+logic [2:0] run_chain;   //CHAIN of the job in progress
+logic run_pass;          //ABC: 0 = A×B pass, 1 = ×C pass
+logic mode_c_sel;        //MODE bit12, the B windows write C
+logic [4:0] mode_chain_shift; //MODE bits 20..16, right shift of a product fed back into A
+logic [4:0] run_shift;   //CHAIN_SHIFT of the job in progress
+logic start_trans_a;     //TRANS_A of the pending START
+logic start_trans_b;     //TRANS_B of the pending START
+logic run_trans_a;       //the job in progress reads A transposed
+logic run_trans_b;       //the job in progress reads B transposed
+logic run_reuse_b;   //the job in progress keeps the B of its bank, FETCH only reads A
+logic [1:0] b_valid; //per-bank B_VALID, B has been written since reset
+logic irq_enable;  //IRQ_ENABLE bit
+logic irq_pending; //IRQ_PENDING bit, set on the rising edge of done_bit
+logic done_bit_q;  //done_bit delayed by a cycle, for the edge detection
+
+//Streaming (Avalon-ST) controls
+logic stream_en;        //MODE bit0, take jobs from the sink
+logic [2:0] stream_ops; //MODE bits 3..1, operation mask of stream jobs (0 = all)
+logic stream_reuse_b;   //MODE bit4, stream packets carry only A
+logic mode_int8;        //MODE bit8, int8 operands four per word, two k terms per MAC cycle
+logic mode_sat;         //MODE bit9, saturating PROD
+logic res_interleave;   //MODE bit10, RESULT window element by element instead of matrix by matrix
+logic mode_zero_skip;   //MODE bit11, skip k steps with an all-zero A column or B row
+logic run_skip;         //zero skip for the job in progress
+logic [N-1:0] row_valid_a;     //ROW_VALID A rows
+logic [N-1:0] row_valid_b;     //ROW_VALID B rows
+logic [N-1:0] run_rows_a;      //rows of A used by the job in progress, the others read as zero
+logic [N-1:0] run_rows_b;      //rows of B used by the job in progress
+logic [N-1:0] k_live;          //k terms that can add something (A column k and B row k both non-zero)
+logic [K_W-1:0] k_live_next;   //next k after the current one with a live term, N if none
+logic [K_W-1:0] skip_job;      //k steps skipped by the job in progress
+logic [15:0] skip_last;        //SKIP_LAST
+logic [31:0] skip_total;       //SKIP_TOTAL
+logic [2:0] bank_ops [0:1]; //op mask of the last job finished on each bank, for the RESULT window
+logic run_int8;         //INT8 of the job in progress
+logic run_sat;          //SAT_PROD of the job in progress
+logic [CNT_W-1:0] fetch_a_words; //FETCH: A words per pair, NN/2 (int16) or NN/4 (INT8)
+logic [31:0] src_stride; //bytes from one operand matrix of a batch to the next
+logic [31:0] step_a;     //bytes from the A of one pair of a batch to the next (DMA_STEP)
+logic [31:0] step_b;     //same for B
+logic [CNT_W-1:0] row_words; //FETCH: packed words per operand row, N/2 (int16) or N/4 (INT8)
+logic [31:0] fetch_a_addr;   //FETCH: address of A word dma_count
+logic [31:0] fetch_b_addr;   //FETCH: address of B word dma_count - fetch_a_words
+logic stream_job;       //the job in progress came from the sink, results go out of the source
+logic stream_start;     //a stream job can start: enabled and the sink has data
+logic fetch_valid;      //FETCH: an operand word arrives this cycle (DMA read data or sink beat)
+logic [31:0] fetch_data;      //FETCH: that word
+logic [CNT_W-1:0] fetch_idx;  //FETCH: its position in the packet
+
+//Job queues: input entries hold the operands, result entries a SUM/DIFF/PROD set
+//(not reset, only the pointers and counts are)
+logic signed [15:0] jq_a [0:JQ_DEPTH-1][0:NN-1];
+logic signed [15:0] jq_b [0:JQ_DEPTH-1][0:NN-1];
+logic signed [31:0] jq_sum [0:JQ_DEPTH-1][0:NN-1];
+logic signed [31:0] jq_diff [0:JQ_DEPTH-1][0:NN-1];
+logic signed [31:0] jq_prod [0:JQ_DEPTH-1][0:NN-1];
+logic [JQ_W-1:0] inq_wr, inq_rd;    //input queue: entry being written by the host, entry being computed
+logic [JQ_W-1:0] outq_wr, outq_rd;  //result queue: entry being filled, head entry read by the host
+logic [JQ_CW-1:0] inq_count, outq_count; //occupancy
+logic jobq_overflow;  //a JOBQ_IN write was dropped, the input queue was full
+logic queue_job;      //the job in progress is a queued one, operands/results in the queue entries
+logic queue_start;    //a queued job can start: an input entry and a free result entry
+logic q_finish;       //last cycle of the queued job in progress, its results go into the result queue
+logic q_continue;     //at q_finish: the next queued job starts on the next cycle
+logic inq_push, outq_pop, jobq_flush;  //host side queue operations this cycle
+
+//Operands of the job in progress: its bank, or its input queue entry
+logic signed [15:0] opA [0:NN-1];
+logic signed [15:0] opB [0:NN-1];
+logic signed [ACC_W-1:0] mac_next [0:NN-1]; //accumulator values after this RUN cycle
+logic signed [ACC_W-1:0] mac_term [0:NN-1]; //what this RUN cycle's multipliers add (k term(s), or the full dot)
+logic signed [ACC_W-1:0] mul_q [0:NN-1];    //PIPELINE_MAC: mac_term of the previous RUN cycle
+logic signed [ACC_W-1:0] acc_final [0:NN-1]; //complete sum in the copy cycle (with the last registered term)
+logic signed [63:0] acc_wide [0:NN-1];      //acc_final sign extended to 64 bits, for PROD/PROD_HI/PROD_OVF
 
     
 //Input and output storage
-//Input matrices A and B (16 elements each, 4×4 flattened) - 16-bit signed
-logic signed [15:0] A [0:15]; // signed to handle negative numbers, received from the C
-logic signed [15:0] B [0:15];
+//Every matrix exists in two banks (first index) for double buffering
+//Input matrices A and B (NN elements each, N×N flattened row-major) - 16-bit signed
+logic signed [15:0] A [0:1][0:NN-1]; // signed to handle negative numbers, received from the C
+logic signed [15:0] B [0:1][0:NN-1];
+logic signed [15:0] C [0:1][0:NN-1]; //third operand of the chained operations, written through the B windows with C_SELECT
 
 //Output matrices: SUM (A+B), DIFF (A−B) and PROD (A×B) - all of them are 32-bit signed
-logic signed [31:0] SUM [0:15];  //it would have worked with even the 17 bit, but to be consistent with others, we use 32 bit
-logic signed [31:0] DIFF [0:15];  //similarly, here also 32 bits, to be consistent
-logic signed [31:0] PROD [0:15]; //32 bits to store the product result
+logic signed [31:0] SUM [0:1][0:NN-1];  //it would have worked with even the 17 bit, but to be consistent with others, we use 32 bit
+logic signed [31:0] DIFF [0:1][0:NN-1];  //similarly, here also 32 bits, to be consistent
+logic signed [31:0] PROD [0:1][0:NN-1]; //32 bits to store the product result
+logic signed [31:0] PROD_HI [0:1][0:NN-1]; //upper 32 bits of the 64-bit product
+logic [NN-1:0] prod_ovf [0:1];             //bit idx: PROD[idx] is not the full product
 
 //Internal 64‑bit accumulators for the product; one per result
-logic signed [63:0] prod_accum [0:15];  //it's 64 bit to avoid probable overflow during accumulation of products
+logic signed [ACC_W-1:0] prod_accum [0:NN-1];  //it's 64 bit (ACC_W) to avoid probable overflow during accumulation of products
 //later, only the lower 32 bits will be stored in the output PROD matrix
 //moreover, I was designing the matrix multiplier for 32 bit inputs initially, later changed to 16 bit, and this part remained unrevised
 
+//DMA master registers
+logic [31:0] dma_src_a;  //byte address of A in memory
+logic [31:0] dma_src_b;  //byte address of B in memory
+logic [31:0] dma_stride_a; //row stride of A in memory, 0 = dense
+logic [31:0] dma_stride_b; //row stride of B in memory, 0 = dense
+logic [3:0] dma_step;      //DMA_STEP, bit1..0 A, bit3..2 B
+logic [31:0] dma_dst;    //byte address of the result block in memory
+logic [CNT_W-1:0] dma_count;  //FETCH: read commands issued (0..NN)
+logic [CNT_W-1:0] fetch_recv; //FETCH: read words received (0..NN)
+logic [CNT_W-1:0] fetch_words; //FETCH: words per pair, NN (A and B) or NN/2 (A only, REUSE_B)
+logic [1:0] wb_group;    //WRITEBACK: result matrix being written, 0 = SUM, 1 = DIFF, 2 = PROD
+logic [IDX_W-1:0] wb_idx;     //WRITEBACK: element of that matrix
+logic dma_accept;        //the master's current command is accepted this cycle
+logic [1:0] wb_first;    //WRITEBACK: first selected result matrix
+logic [1:0] wb_next;     //WRITEBACK: selected result matrix after wb_group
+logic wb_last;           //WRITEBACK: wb_group/wb_idx is the last word of the last selected matrix
+
+//Batch registers, the DMA addresses above are the programmed start of each array,
+//the cur_* copies walk through the arrays so the programmed values stay readable
+logic [15:0] batch_count;  //number of pairs per START
+logic [15:0] batch_done;   //pairs completed so far
+logic [31:0] cur_src_a;    //address of the A of the pair in progress
+logic [31:0] cur_src_b;    //address of the B of the pair in progress
+logic [31:0] cur_dst;      //address of the result block of the pair in progress
+logic batch_last;          //the pair in progress is the last one of the batch
+
 //FSM registers
-typedef enum logic [1:0] {LOAD_AB, RUN, DONE} state_t;
+typedef enum logic [2:0] {LOAD_AB, FETCH, RUN, WRITEBACK, DONE} state_t;
 state_t state, nextstate;
 
-//Inner‑loop index k (0..4) for the four terms of the dot product (goes to 4 for final copy)
-logic [2:0] k; //that's why it's of 3 bits, to count from 0 to 4 (could count up to 0 to 7 with 3 bits, but not an issue)
+//Avalon burst tracking: the master only presents the first address of a burst,
+//so the following beat addresses are generated here
+logic [ADDR_W-1:0] wr_burst_addr;  //address of the next beat of a write burst
+logic [4:0] wr_burst_left;  //beats still to come in the current write burst (0 = no burst)
+logic [ADDR_W-1:0] rd_burst_addr;  //address of the next beat of a read burst
+logic [4:0] rd_burst_left;  //beats still to return in the current read burst (0 = no burst)
+logic [ADDR_W-1:0] wr_addr;        //address the current write beat goes to
+logic [ADDR_W-1:0] rd_addr;        //address the read mux is looking at this cycle
+logic [31:0] rd_mux_data;   //combinational read mux output, registered into readdata
+logic res_valid;            //the RESULT word at rd_addr holds a result
+logic [1:0] res_sel;        //matrix of that word, 0 = SUM, 1 = DIFF, 2 = PROD
+logic [IDX_W-1:0] res_elem; //element of that word
+logic bus_write;            //a write beat is accepted this cycle
+logic bus_read;             //a read command is accepted this cycle
+
+//Performance counters
+logic [31:0] perf [0:PERF_COUNT-1];
+logic perf_freeze;   //PERF_CTRL.FREEZE
+logic perf_ctrl_wr;  //PERF_CTRL written this cycle
+logic job_start;     //a job is picked up in LOAD_AB this cycle
+
+assign waitrequest = (rd_burst_left != 5'd0);  //hold off new commands while a read burst is returning
+assign bus_write = chipselect && write && !waitrequest;
+assign bus_read = chipselect && read && !waitrequest;
+assign wr_addr = (wr_burst_left != 5'd0) ? wr_burst_addr : address;
+assign rd_addr = (rd_burst_left != 5'd0) ? rd_burst_addr : address;
+
+//Merges the enabled byte lanes of a 16-bit write into the old register value
+function automatic logic [15:0] merge_bytes16(input logic [15:0] old_val, input logic [15:0] new_val, input logic [1:0] be);
+    merge_bytes16 = {be[1] ? new_val[15:8] : old_val[15:8], be[0] ? new_val[7:0] : old_val[7:0]};
+endfunction
+
+//Stored index of element idx = [r][c] of a matrix read transposed ([c][r]), or idx itself
+function automatic int src_idx(input int idx, input logic transpose);
+    src_idx = transpose ? (idx % N)*N + idx / N : idx;
+endfunction
+
+//Inner‑loop index k (0..N) for the N terms of the dot product (goes to N for final copy)
+logic [K_W-1:0] k; //wide enough to count from 0 to N
+logic first_k; //k == 0, the accumulators start from zero instead of their old value (unless ACCUM)
+
+assign first_k = (k == '0);
+
+//PARALLEL_MUL: the complete dot product of every output element, from the run bank
+logic signed [63:0] full_dot [0:NN-1];
 
 //Sequential logic: state transitions, writes and computation
 always_ff @(posedge clk or posedge reset) 
@@ -69,286 +566,1015 @@ always_ff @(posedge clk or posedge reset)
             start_bit <= 1'b0;
             busy_bit <= 1'b0;
             done_bit <= 1'b0;
+            dma_bit <= 1'b0;
+            dma_job <= 1'b0;
+            start_bank <= 1'b0;
+            run_bank <= 1'b0;
+            host_bank <= 1'b0;
+            done_bank <= 2'b00;
+            start_ops <= 3'b111;
+            run_ops <= 3'b111;
+            start_accum <= 1'b0;
+            run_accum <= 1'b0;
+            clear_acc <= 1'b0;
+            start_reuse_b <= 1'b0;
+            run_reuse_b <= 1'b0;
+            start_chain <= CHAIN_NONE;
+            run_chain <= CHAIN_NONE;
+            run_pass <= 1'b0;
+            mode_c_sel <= 1'b0;
+            mode_chain_shift <= 5'd0;
+            run_shift <= 5'd0;
+            start_trans_a <= 1'b0;
+            start_trans_b <= 1'b0;
+            run_trans_a <= 1'b0;
+            run_trans_b <= 1'b0;
+            b_valid <= 2'b00;
+            irq_enable <= 1'b0;
+            irq_pending <= 1'b0;
+            done_bit_q <= 1'b0;
+            stream_en <= 1'b0;
+            stream_ops <= 3'b000;
+            stream_reuse_b <= 1'b0;
+            mode_int8 <= 1'b0;
+            mode_sat <= 1'b0;
+            res_interleave <= 1'b0;
+            mode_zero_skip <= 1'b0;
+            run_skip <= 1'b0;
+            row_valid_a <= '1;
+            row_valid_b <= '1;
+            run_rows_a <= '1;
+            run_rows_b <= '1;
+            skip_job <= '0;
+            skip_last <= 16'd0;
+            skip_total <= 32'd0;
+            bank_ops[0] <= 3'b111;
+            bank_ops[1] <= 3'b111;
+            run_int8 <= 1'b0;
+            run_sat <= 1'b0;
+            stream_job <= 1'b0;
+            inq_wr <= '0;
+            inq_rd <= '0;
+            outq_wr <= '0;
+            outq_rd <= '0;
+            inq_count <= '0;
+            outq_count <= '0;
+            jobq_overflow <= 1'b0;
+            queue_job <= 1'b0;
+            dma_src_a <= 32'd0;
+            dma_src_b <= 32'd0;
+            dma_stride_a <= 32'd0;
+            dma_stride_b <= 32'd0;
+            dma_step <= 4'd0;
+            dma_dst <= 32'd0;
+            dma_count <= '0;
+            fetch_recv <= '0;
+            wb_group <= 2'd0;
+            wb_idx <= '0;
+            batch_count <= 16'd1;
+            batch_done <= 16'd0;
+            cur_src_a <= 32'd0;
+            cur_src_b <= 32'd0;
+            cur_dst <= 32'd0;
             state <= LOAD_AB;
-            k <= 3'd0;
+            k <= '0;
+            wr_burst_addr <= '0;
+            wr_burst_left <= 5'd0;
             //Clear matrices and accumulators
-            for (int idx = 0; idx < 16; idx++) 
+            for (int idx = 0; idx < NN; idx++) 
             begin
-                A[idx] <= 16'd0;
-                B[idx] <= 16'd0;
-                SUM[idx] <= 32'd0;
-                DIFF[idx] <= 32'd0;
-                PROD[idx] <= 32'd0;
-                prod_accum[idx] <= 64'd0;
+                for (int bank = 0; bank < 2; bank++)
+                begin
+                    A[bank][idx] <= 16'd0;
+                    B[bank][idx] <= 16'd0;
+                    C[bank][idx] <= 16'd0;
+                    SUM[bank][idx] <= 32'd0;
+                    DIFF[bank][idx] <= 32'd0;
+                    PROD[bank][idx] <= 32'd0;
+                    PROD_HI[bank][idx] <= 32'd0;
+                    prod_ovf[bank][idx] <= 1'b0;
+                end
+                prod_accum[idx] <= '0;
+                mul_q[idx] <= '0;
             end
         end else begin
             state <= nextstate;
 
+            //Interrupt: a new DONE wins over a clear written in the same cycle, so no completion is lost
+            done_bit_q <= done_bit;
+            if (bus_write && wr_addr == REG_IRQ)
+            begin
+                if (byteenable[0])
+                begin
+                    irq_enable <= writedata[0];
+                    if (writedata[1])
+                        irq_pending <= 1'b0;
+                end
+            end
+            if (done_bit && !done_bit_q)
+                irq_pending <= 1'b1;
+
+            //Write burst address generation: first beat uses 'address', the rest are counted here
+            if (bus_write)
+            begin
+                if (wr_burst_left != 5'd0)
+                begin
+                    wr_burst_addr <= wr_burst_addr + 1'b1;
+                    wr_burst_left <= wr_burst_left - 5'd1;
+                end else if (burstcount > 5'd1)
+                begin
+                    wr_burst_addr <= address + 1'b1;
+                    wr_burst_left <= burstcount - 5'd1;
+                end
+            end
+
             //Handle writes to input matrices and control register
-            if (chipselect && write) 
+            if (bus_write) 
             begin
-                case (address)
-                    //A[0..15] written at addresses 0..15 (lower 16 bits only)
-                    8'd0: A[0] <= writedata[15:0];
-                    8'd1: A[1] <= writedata[15:0];
-                    8'd2: A[2] <= writedata[15:0];
-                    8'd3: A[3] <= writedata[15:0];
-                    8'd4: A[4] <= writedata[15:0];
-                    8'd5: A[5] <= writedata[15:0];
-                    8'd6: A[6] <= writedata[15:0];
-                    8'd7: A[7] <= writedata[15:0];
-                    8'd8: A[8] <= writedata[15:0];
-                    8'd9: A[9] <= writedata[15:0];
-                    8'd10: A[10] <= writedata[15:0];
-                    8'd11: A[11] <= writedata[15:0];
-                    8'd12: A[12] <= writedata[15:0];
-                    8'd13: A[13] <= writedata[15:0];
-                    8'd14: A[14] <= writedata[15:0];
-                    8'd15: A[15] <= writedata[15:0];
-
-                    //B[0..15] written at addresses 16..31 (lower 16 bits only)
-                    8'd16: B[0] <= writedata[15:0];
-                    8'd17: B[1] <= writedata[15:0];
-                    8'd18: B[2] <= writedata[15:0];
-                    8'd19: B[3] <= writedata[15:0];
-                    8'd20: B[4] <= writedata[15:0];
-                    8'd21: B[5] <= writedata[15:0];
-                    8'd22: B[6] <= writedata[15:0];
-                    8'd23: B[7] <= writedata[15:0];
-                    8'd24: B[8] <= writedata[15:0];
-                    8'd25: B[9] <= writedata[15:0];
-                    8'd26: B[10] <= writedata[15:0];
-                    8'd27: B[11] <= writedata[15:0];
-                    8'd28: B[12] <= writedata[15:0];
-                    8'd29: B[13] <= writedata[15:0];
-                    8'd30: B[14] <= writedata[15:0];
-                    8'd31: B[15] <= writedata[15:0];
-
-                    //ONTROL register at address 80: bit0 = START
-                    8'd80: begin
-                        start_bit <= writedata[0];
+                //A[0..NN-1] and B[0..NN-1], one element per word (lower 16 bits only)
+                if (wr_addr < ADDR_W'(B_BASE))
+                    A[host_bank][wr_addr - ADDR_W'(A_BASE)] <= merge_bytes16(A[host_bank][wr_addr - ADDR_W'(A_BASE)], writedata[15:0], byteenable[1:0]);
+                else if (wr_addr < ADDR_W'(SUM_BASE) && mode_c_sel)
+                    C[host_bank][wr_addr - ADDR_W'(B_BASE)] <= merge_bytes16(C[host_bank][wr_addr - ADDR_W'(B_BASE)], writedata[15:0], byteenable[1:0]);
+                else if (wr_addr < ADDR_W'(SUM_BASE))
+                begin
+                    B[host_bank][wr_addr - ADDR_W'(B_BASE)] <= merge_bytes16(B[host_bank][wr_addr - ADDR_W'(B_BASE)], writedata[15:0], byteenable[1:0]);
+                    b_valid[host_bank] <= 1'b1;
+                end
+
+                //A_PACKED and B_PACKED, two elements per write: element 2w in [15:0], 2w+1 in [31:16]
+                //(INT8 mode: four elements per write, element 4w+b in byte b, sign-extended, words 0..NN/4-1 only)
+                else if (wr_addr >= ADDR_W'(A_PACKED_BASE) && wr_addr < ADDR_W'(B_PACKED_BASE))
+                begin
+                    if (!mode_int8)
+                    begin
+                        A[host_bank][2*(wr_addr - ADDR_W'(A_PACKED_BASE))] <= merge_bytes16(A[host_bank][2*(wr_addr - ADDR_W'(A_PACKED_BASE))], writedata[15:0], byteenable[1:0]);
+                        A[host_bank][2*(wr_addr - ADDR_W'(A_PACKED_BASE)) + 1] <= merge_bytes16(A[host_bank][2*(wr_addr - ADDR_W'(A_PACKED_BASE)) + 1], writedata[31:16], byteenable[3:2]);
+                    end else if (wr_addr < ADDR_W'(A_PACKED_BASE + QUARTER))
+                    begin
+                        for (int b = 0; b < 4; b++)
+                            if (byteenable[b])
+                                A[host_bank][4*(wr_addr - ADDR_W'(A_PACKED_BASE)) + b] <= {{8{writedata[8*b + 7]}}, writedata[8*b +: 8]};
                     end
+                end
+                else if (wr_addr >= ADDR_W'(B_PACKED_BASE) && wr_addr < ADDR_W'(JOBQ_IN_BASE) && mode_c_sel)
+                begin
+                    //C_SELECT: packed C, int16 only
+                    C[host_bank][2*(wr_addr - ADDR_W'(B_PACKED_BASE))] <= merge_bytes16(C[host_bank][2*(wr_addr - ADDR_W'(B_PACKED_BASE))], writedata[15:0], byteenable[1:0]);
+                    C[host_bank][2*(wr_addr - ADDR_W'(B_PACKED_BASE)) + 1] <= merge_bytes16(C[host_bank][2*(wr_addr - ADDR_W'(B_PACKED_BASE)) + 1], writedata[31:16], byteenable[3:2]);
+                end
+                else if (wr_addr >= ADDR_W'(B_PACKED_BASE) && wr_addr < ADDR_W'(JOBQ_IN_BASE))
+                begin
+                    if (!mode_int8)
+                    begin
+                        B[host_bank][2*(wr_addr - ADDR_W'(B_PACKED_BASE))] <= merge_bytes16(B[host_bank][2*(wr_addr - ADDR_W'(B_PACKED_BASE))], writedata[15:0], byteenable[1:0]);
+                        B[host_bank][2*(wr_addr - ADDR_W'(B_PACKED_BASE)) + 1] <= merge_bytes16(B[host_bank][2*(wr_addr - ADDR_W'(B_PACKED_BASE)) + 1], writedata[31:16], byteenable[3:2]);
+                    end else if (wr_addr < ADDR_W'(B_PACKED_BASE + QUARTER))
+                    begin
+                        for (int b = 0; b < 4; b++)
+                            if (byteenable[b])
+                                B[host_bank][4*(wr_addr - ADDR_W'(B_PACKED_BASE)) + b] <= {{8{writedata[8*b + 7]}}, writedata[8*b +: 8]};
+                    end
+                    b_valid[host_bank] <= 1'b1;
+                end
+
+                //JOBQ_IN: packed A then packed B of the next queue entry, pushed by the last word (see inq_push)
+                else if (wr_addr >= ADDR_W'(JOBQ_IN_BASE) && wr_addr < ADDR_W'(JOBQ_OUT_BASE))
+                begin
+                    if (inq_count == JQ_CW'(JQ_DEPTH))
+                        jobq_overflow <= 1'b1;  //full: the entry at inq_wr is the one being computed, do not touch it
+                    else if (wr_addr < ADDR_W'(JOBQ_IN_BASE + HALF))
+                    begin
+                        jq_a[inq_wr][2*(wr_addr - ADDR_W'(JOBQ_IN_BASE))] <= merge_bytes16(jq_a[inq_wr][2*(wr_addr - ADDR_W'(JOBQ_IN_BASE))], writedata[15:0], byteenable[1:0]);
+                        jq_a[inq_wr][2*(wr_addr - ADDR_W'(JOBQ_IN_BASE)) + 1] <= merge_bytes16(jq_a[inq_wr][2*(wr_addr - ADDR_W'(JOBQ_IN_BASE)) + 1], writedata[31:16], byteenable[3:2]);
+                    end else
+                    begin
+                        jq_b[inq_wr][2*(wr_addr - ADDR_W'(JOBQ_IN_BASE + HALF))] <= merge_bytes16(jq_b[inq_wr][2*(wr_addr - ADDR_W'(JOBQ_IN_BASE + HALF))], writedata[15:0], byteenable[1:0]);
+                        jq_b[inq_wr][2*(wr_addr - ADDR_W'(JOBQ_IN_BASE + HALF)) + 1] <= merge_bytes16(jq_b[inq_wr][2*(wr_addr - ADDR_W'(JOBQ_IN_BASE + HALF)) + 1], writedata[31:16], byteenable[3:2]);
+                    end
+                end
+
+                case (wr_addr)
+                    //CONTROL register: bit0 = START
+                    REG_CONTROL: begin
+                        if (byteenable[0])
+                        begin
+                            host_bank <= writedata[3];
+                            if (writedata[0])
+                            begin
+                                start_bit <= 1'b1;
+                                dma_bit <= writedata[1];
+                                start_bank <= writedata[2];
+                                start_ops <= (writedata[6:4] == 3'b000) ? 3'b111 : writedata[6:4];
+                                start_accum <= writedata[7];
+                                start_reuse_b <= byteenable[1] && writedata[9];
+                                start_chain <= (byteenable[1] && writedata[12:10] <= CHAIN_ABC) ? writedata[12:10] : CHAIN_NONE;  //4..7 reserved, = none
+                                start_trans_a <= byteenable[1] && writedata[13];
+                                start_trans_b <= byteenable[1] && writedata[14];
+                                done_bit <= 1'b0;  //clear DONE right away, so a STATUS read issued back-to-back with
+                                                   //the START write cannot see the DONE of the previous job
+                                done_bank[writedata[2]] <= 1'b0;
+                            end
+                        end
+                        if (byteenable[1] && writedata[8])
+                            clear_acc <= 1'b1;
+                    end
+
+                    //MODE register, streaming setup
+                    REG_MODE: begin
+                        if (byteenable[0])
+                        begin
+                            stream_en <= writedata[0];
+                            stream_ops <= writedata[3:1];
+                            stream_reuse_b <= writedata[4];
+                        end
+                        if (byteenable[1])
+                        begin
+                            mode_int8 <= writedata[8];
+                            mode_sat <= writedata[9];
+                            res_interleave <= writedata[10];
+                            mode_zero_skip <= writedata[11];
+                            mode_c_sel <= writedata[12];
+                        end
+                        if (byteenable[2])
+                            mode_chain_shift <= writedata[20:16];
+                    end
+
+                    //Zero skip statistics and row-valid mask
+                    REG_SKIP_TOTAL: skip_total <= 32'd0;
+                    REG_ROW_VALID: begin
+                        //byte by byte like the operand windows, so a byte or halfword store only changes the mask bits it covers
+                        //(bytes 1 and 3 only matter for N > 8)
+                        row_valid_a <= N'(merge_bytes16(16'(row_valid_a), writedata[15:0], byteenable[1:0]));
+                        row_valid_b <= N'(merge_bytes16(16'(row_valid_b), writedata[31:16], byteenable[3:2]));
+                    end
+
+                    //DMA address registers
+                    REG_DMA_SRC_A: dma_src_a <= writedata;
+                    REG_DMA_SRC_B: dma_src_b <= writedata;
+                    REG_DMA_DST: dma_dst <= writedata;
+                    REG_DMA_STRIDE_A: dma_stride_a <= writedata;
+                    REG_DMA_STRIDE_B: dma_stride_b <= writedata;
+                    REG_DMA_STEP: dma_step <= writedata[3:0];
+                    REG_BATCH_COUNT: batch_count <= writedata[15:0];
+                    //REG_JOBQ: POP and FLUSH are done with the queue pointers below
                     default: ;
                 endcase
             end
 
-            
+            //DMA master bookkeeping, addresses and data are generated combinationally below
+            if (dma_accept)
+            begin
+                if (state == FETCH)
+                    dma_count <= dma_count + 1'b1;
+                else if (wb_idx != IDX_W'(NN - 1))
+                    wb_idx <= wb_idx + 1'b1;
+                else
+                begin
+                    wb_idx <= '0;
+                    wb_group <= wb_next;
+                end
+            end
+
+            //Job queue pointers and occupancy, a push and a pop of the same queue can happen in the same cycle
+            //(the engine pops the input queue and pushes the result queue at q_finish)
+            if (jobq_flush)
+            begin
+                inq_wr <= '0;
+                inq_rd <= '0;
+                outq_wr <= '0;
+                outq_rd <= '0;
+                inq_count <= '0;
+                outq_count <= '0;
+                jobq_overflow <= 1'b0;
+            end else
+            begin
+                if (inq_push)
+                    inq_wr <= inq_wr + 1'b1;
+                if (q_finish)
+                begin
+                    inq_rd <= inq_rd + 1'b1;
+                    outq_wr <= outq_wr + 1'b1;
+                end
+                if (outq_pop)
+                    outq_rd <= outq_rd + 1'b1;
+                inq_count <= inq_count + JQ_CW'(inq_push) - JQ_CW'(q_finish);
+                outq_count <= outq_count + JQ_CW'(q_finish) - JQ_CW'(outq_pop);
+            end
+
             //FSM States
             case (state)
-                //LOAD_AB: wait for start and compute SUM/DIFF when start asserted
+                //LOAD_AB: wait for start, then go to RUN (operands already loaded over the slave)
+                //or to FETCH (operands are read over the DMA master)
                 LOAD_AB: 
                 begin
                     busy_bit <= 1'b0; //this is initialized to 0, for safety, when the FSM returns to this state from DONE
+                    if (clear_acc)
+                    begin
+                        //CLEAR_ACC: also done in this cycle when a START is picked up, so the job sees zeros
+                        for (int idx = 0; idx < NN; idx++)
+                            prod_accum[idx] <= '0;
+                        clear_acc <= 1'b0;
+                    end
                     //Only initialize when start signal is received
                     if (start_bit) 
                     begin
                         busy_bit <= 1'b1;
                         done_bit <= 1'b0;
-                        k <= 3'd0;
-                        //Compute SUM and DIFF for each element SUM[i] = A[i] + B[i]
-                        SUM[0] <= A[0] + B[0];
-                        SUM[1] <= A[1] + B[1];
-                        SUM[2] <= A[2] + B[2];
-                        SUM[3] <= A[3] + B[3];
-                        SUM[4] <= A[4] + B[4];
-                        SUM[5] <= A[5] + B[5];
-                        SUM[6] <= A[6] + B[6];
-                        SUM[7] <= A[7] + B[7];
-                        SUM[8] <= A[8] + B[8];
-                        SUM[9] <= A[9] + B[9];
-                        SUM[10] <= A[10] + B[10];
-                        SUM[11] <= A[11] + B[11];
-                        SUM[12] <= A[12] + B[12];
-                        SUM[13] <= A[13] + B[13];
-                        SUM[14] <= A[14] + B[14];
-                        SUM[15] <= A[15] + B[15];
-
-                        DIFF[0] <= A[0] - B[0];  //Compute DIFF[i] = A[i] - B[i]
-                        DIFF[1] <= A[1] - B[1];
-                        DIFF[2] <= A[2] - B[2];
-                        DIFF[3] <= A[3] - B[3];
-                        DIFF[4] <= A[4] - B[4];
-                        DIFF[5] <= A[5] - B[5];
-                        DIFF[6] <= A[6] - B[6];
-                        DIFF[7] <= A[7] - B[7];
-                        DIFF[8] <= A[8] - B[8];
-                        DIFF[9] <= A[9] - B[9];
-                        DIFF[10] <= A[10] - B[10];
-                        DIFF[11] <= A[11] - B[11];
-                        DIFF[12] <= A[12] - B[12];
-                        DIFF[13] <= A[13] - B[13];
-                        DIFF[14] <= A[14] - B[14];
-                        DIFF[15] <= A[15] - B[15];
-
-                        prod_accum[0] <= 64'd0;  //Initialize product accumulators to zero
-                        prod_accum[1] <= 64'd0;  //these accumulators are to store the intermediate sums of products
-                        prod_accum[2] <= 64'd0; //it first stores the product of first elment of row, and first element of column
-                        prod_accum[3] <= 64'd0; //then it stores the sum of previous partial product, and ..
-                        prod_accum[5] <= 64'd0; //the product of second element of row and second element of column and so on
-                        prod_accum[4] <= 64'd0; //it iterates and stores the product of k element of row and k element of column, until k =4
-                        prod_accum[6] <= 64'd0; //on fifth(k=4) iteration, it goes to the else block, and stores the final results in PROD matrix
-                        prod_accum[7] <= 64'd0;
-                        prod_accum[8] <= 64'd0;
-                        prod_accum[9] <= 64'd0;
-                        prod_accum[10] <= 64'd0;
-                        prod_accum[11] <= 64'd0;
-                        prod_accum[12] <= 64'd0;
-                        prod_accum[13] <= 64'd0;
-                        prod_accum[14] <= 64'd0;
-                        prod_accum[15] <= 64'd0;
+                        k <= '0;
+                        dma_job <= dma_bit;
+                        stream_job <= 1'b0;
+                        queue_job <= 1'b0;
+                        run_bank <= start_bank;
+                        run_int8 <= mode_int8;
+                        run_sat <= mode_sat;
+                        //chained jobs (int16 only) always compute PROD and never accumulate
+                        run_chain <= mode_int8 ? CHAIN_NONE : start_chain;
+                        run_pass <= 1'b0;
+                        run_shift <= mode_chain_shift;
+                        run_trans_a <= start_trans_a;
+                        run_trans_b <= start_trans_b;
+                        run_ops <= (!mode_int8 && start_chain != CHAIN_NONE) ? (start_ops | 3'b100) : start_ops;
+                        run_skip <= mode_zero_skip && !mode_int8;
+                        run_rows_a <= dma_bit ? {N{1'b1}} : row_valid_a;  //ROW_VALID only for slave jobs
+                        run_rows_b <= dma_bit ? {N{1'b1}} : row_valid_b;
+                        skip_job <= '0;
+                        run_accum <= start_accum && (mode_int8 || start_chain == CHAIN_NONE);
+                        run_reuse_b <= start_reuse_b;
+                        dma_count <= '0;
+                        fetch_recv <= '0;
+                        batch_done <= 16'd0;
+                        cur_src_a <= dma_src_a;
+                        cur_src_b <= dma_src_b;
+                        cur_dst <= dma_dst;
                         start_bit <= 1'b0;
+                    end else if (stream_start)
+                    begin
+                        //stream job: operands from the sink into bank 0, results out of the source
+                        busy_bit <= 1'b1;
+                        k <= '0;
+                        dma_job <= 1'b0;
+                        stream_job <= 1'b1;
+                        queue_job <= 1'b0;
+                        run_bank <= 1'b0;
+                        run_ops <= (stream_ops == 3'b000) ? 3'b111 : stream_ops;
+                        run_chain <= CHAIN_NONE;
+                        run_pass <= 1'b0;
+                        run_trans_a <= 1'b0;
+                        run_trans_b <= 1'b0;
+                        run_accum <= 1'b0;
+                        run_reuse_b <= stream_reuse_b;
+                        run_int8 <= mode_int8;
+                        run_sat <= mode_sat;
+                        run_skip <= mode_zero_skip && !mode_int8;
+                        run_rows_a <= '1;
+                        run_rows_b <= '1;
+                        skip_job <= '0;
+                        fetch_recv <= '0;
+                    end else if (queue_start)
+                    begin
+                        //queued job: operands from the input queue head, straight to RUN
+                        busy_bit <= 1'b1;
+                        k <= '0;
+                        dma_job <= 1'b0;
+                        stream_job <= 1'b0;
+                        queue_job <= 1'b1;
+                        run_ops <= 3'b111;
+                        run_chain <= CHAIN_NONE;
+                        run_pass <= 1'b0;
+                        run_trans_a <= 1'b0;
+                        run_trans_b <= 1'b0;
+                        run_accum <= 1'b0;
+                        run_int8 <= 1'b0;  //the queue entries are int16
+                        run_skip <= 1'b0;  //q_finish needs every k step
+                        run_sat <= mode_sat;
+                    end
+                end
+
+                //FETCH: NN packed words, NN/2 for A from cur_src_a then NN/2 for B from cur_src_b
+                //(only the A words with REUSE_B), reads are issued back to back, the data comes back in order on dma_readdatavalid
+                //a stream job takes the same words from the sink instead
+                FETCH:
+                begin
+                    if (fetch_valid)
+                    begin
+                        if (run_int8)
+                        begin
+                            //INT8: four elements per word, NN/4 words per matrix
+                            if (fetch_idx < fetch_a_words)
+                            begin
+                                for (int b = 0; b < 4; b++)
+                                    A[run_bank][4*fetch_idx + b] <= {{8{fetch_data[8*b + 7]}}, fetch_data[8*b +: 8]};
+                            end else
+                            begin
+                                for (int b = 0; b < 4; b++)
+                                    B[run_bank][4*(fetch_idx - fetch_a_words) + b] <= {{8{fetch_data[8*b + 7]}}, fetch_data[8*b +: 8]};
+                                b_valid[run_bank] <= 1'b1;
+                            end
+                        end else if (fetch_idx < fetch_a_words)
+                        begin
+                            A[run_bank][2*fetch_idx] <= fetch_data[15:0];
+                            A[run_bank][2*fetch_idx + 1] <= fetch_data[31:16];
+                        end else
+                        begin
+                            B[run_bank][2*(fetch_idx - fetch_a_words)] <= fetch_data[15:0];
+                            B[run_bank][2*(fetch_idx - fetch_a_words) + 1] <= fetch_data[31:16];
+                            b_valid[run_bank] <= 1'b1;
+                        end
+                        fetch_recv <= fetch_idx + 1'b1;
                     end
                 end
 
  // RUN: perform dot‑product accumulations for PROD
-     // Matrix multiplication: C[i][j] = sum of A[i][k] * B[k][j] for k=0..3
- //to store the product as in above formulat, from the flattened arrays, we use: C[i*4+j] = sum of A[i*4+k] * B[k*4+j]
+     // Matrix multiplication: C[i][j] = sum of A[i][k] * B[k][j] for k=0..N-1
+ //to store the product as in above formulat, from the flattened arrays, we use: C[i*N+j] = sum of A[i*N+k] * B[k*N+j]
+ //SUM and DIFF are computed in the first cycle (k = 0) together with the first partial products,
+ //and the accumulators start from zero in that cycle, so no separate initialization cycle is needed
                 RUN: 
                 begin
-                    if (k != 3'd4)  //For k = 0,1,2,3 accumulate all partial products
-                    //(k < 4) also works, but I used (k != 4) for clarity
+                    if (k != K_W'(N))  //For k = 0..N-1 accumulate all partial products
+                    begin
+                        if (first_k && !run_pass && run_chain != CHAIN_ADD_C)
+                        begin
+                            //Compute SUM and DIFF for each element SUM[i] = A[i] + B[i], if selected
+                            //(a queued job writes them into its result queue entry instead of a bank;
+                            //ADD_C does them in the copy cycle, from PROD and C)
+                            for (int idx = 0; idx < NN; idx++)
+                            begin
+                                if (queue_job)
+                                begin
+                                    jq_sum[outq_wr][idx] <= opA[idx] + opB[idx];
+                                    jq_diff[outq_wr][idx] <= opA[idx] - opB[idx];
+                                end else
+                                begin
+                                    if (run_ops[0])
+                                        SUM[run_bank][idx] <= opA[idx] + opB[idx];
+                                    if (run_ops[1])
+                                        DIFF[run_bank][idx] <= opA[idx] - opB[idx];  //Compute DIFF[i] = A[i] - B[i]
+                                end
+                            end
+                        end
+
+                        //the MACs only run when PROD is selected, one k term per cycle
+                        //(all N k terms in this one cycle with PARALLEL_MUL), see mac_next below
+                        if (run_ops[2])
+                        begin
+                            for (int idx = 0; idx < NN; idx++)
+                            begin
+                                prod_accum[idx] <= mac_next[idx];
+                                mul_q[idx] <= mac_term[idx];  //only read with PIPELINE_MAC
+                            end
+                        end
+
+                        if (q_finish)
+                        begin
+                            //last k term of a queued job: its PROD goes into the result queue right away,
+                            //without the copy cycle, and the next entry (if q_continue) starts at k = 0
+                            for (int idx = 0; idx < NN; idx++)
+                                jq_prod[outq_wr][idx] <= run_sat ? sat32(64'(mac_next[idx])) : mac_next[idx][31:0];
+                            k <= '0;
+                            if (!q_continue)
+                                busy_bit <= 1'b0;
+                        end else if (run_skip && run_ops[2] && !PARALLEL_MUL)
+                        begin
+                            //ZERO_SKIP: on to the next k that adds something (or the copy cycle)
+                            k <= k_live_next;
+                            skip_job <= skip_job + (k_live_next - k - 1'b1);
+                            skip_total <= skip_total + 32'(k_live_next - k - 1'b1);
+                        end else
+                            k <= (run_ops[2] && !PARALLEL_MUL) ? k + (run_int8 ? K_W'(2) : K_W'(1)) : K_W'(N);  //k increases by 1 on each clock cycle, iteration (by 2 in INT8 mode);  
+                        //without PROD (or with the parallel multiplier), everything is done after this cycle, so go straight to the final step
+                    end else if (queue_job)
                     begin
-                          //for the Row 0 of the product
-                        prod_accum[0]  <= prod_accum[0]  + (A[k] * B[(k*4) + 0]); //C[0][0] += A[0][k]*B[k][0]
-                        prod_accum[1]  <= prod_accum[1]  + (A[k] * B[(k*4) + 1]); //C[0][1] += A[0][k]*B[k][1]
-                        prod_accum[2]  <= prod_accum[2]  + (A[k] * B[(k*4) + 2]); //C[0][2] += A[0][k]*B[k][2]
-                        prod_accum[3]  <= prod_accum[3]  + (A[k] * B[(k*4) + 3]); //C[0][3] += A[0][k]*B[k][3]
-
-                        //Row 1 of result
-                        prod_accum[4]  <= prod_accum[4]  + (A[4 + k] * B[(k*4) + 0]); //C[1][0] += A[1][k]*B[k][0]
-                        prod_accum[5]  <= prod_accum[5]  + (A[4 + k] * B[(k*4) + 1]); //C[1][1] += A[1][k]*B[k][1]
-                        prod_accum[6]  <= prod_accum[6]  + (A[4 + k] * B[(k*4) + 2]); //C[1][2] += A[1][k]*B[k][2]
-                        prod_accum[7]  <= prod_accum[7]  + (A[4 + k] * B[(k*4) + 3]); //C[1][3] += A[1][k]*B[k][3]
-
-                        //Row 2 of result
-                        prod_accum[8]  <= prod_accum[8]  + (A[8 + k] * B[(k*4) + 0]); //C[2][0] += A[2][k]*B[k][0]
-                        prod_accum[9]  <= prod_accum[9]  + (A[8 + k] * B[(k*4) + 1]); //C[2][1] += A[2][k]*B[k][1]
-                        prod_accum[10] <= prod_accum[10] + (A[8 + k] * B[(k*4) + 2]); //C[2][2] += A[2][k]*B[k][2]
-                        prod_accum[11] <= prod_accum[11] + (A[8 + k] * B[(k*4) + 3]); //C[2][3] += A[2][k]*B[k][3]
-
-                        //Row 3 of result
-                        prod_accum[12] <= prod_accum[12] + (A[12 + k] * B[(k*4) + 0]); //C[3][0] += A[3][k]*B[k][0]
-                        prod_accum[13] <= prod_accum[13] + (A[12 + k] * B[(k*4) + 1]); //C[3][1] += A[3][k]*B[k][1]
-                        prod_accum[14] <= prod_accum[14] + (A[12 + k] * B[(k*4) + 2]); //C[3][2] += A[3][k]*B[k][2]
-                        prod_accum[15] <= prod_accum[15] + (A[12 + k] * B[(k*4) + 3]); //C[3][3] += A[3][k]*B[k][3]
-                        k <= k + 3'd1;  //k increases by 1 on each clock cycle, iteration;  
-                    end else 
+                        //PIPELINE_MAC: a queued job finishes here, once its last product is added
+                        for (int idx = 0; idx < NN; idx++)
+                        begin
+                            jq_prod[outq_wr][idx] <= run_sat ? sat32(acc_wide[idx]) : acc_wide[idx][31:0];
+                            prod_accum[idx] <= acc_final[idx];
+                        end
+                        k <= '0;
+                        if (!q_continue)
+                            busy_bit <= 1'b0;
+                    end else
                     begin
-                        //k == 4: copy accumulated results to PROD 4*4 output matrix, ready to be read by C
-                        PROD[0] <= prod_accum[0][31:0];
-                        PROD[1] <= prod_accum[1][31:0];
-                        PROD[2] <= prod_accum[2][31:0];
-                        PROD[3] <= prod_accum[3][31:0];
-                        PROD[4] <= prod_accum[4][31:0];
-                        PROD[5] <= prod_accum[5][31:0];
-                        PROD[6] <= prod_accum[6][31:0];
-                        PROD[7] <= prod_accum[7][31:0];
-                        PROD[8] <= prod_accum[8][31:0];
-                        PROD[9] <= prod_accum[9][31:0];
-                        PROD[10] <= prod_accum[10][31:0];
-                        PROD[11] <= prod_accum[11][31:0];
-                        PROD[12] <= prod_accum[12][31:0];
-                        PROD[13] <= prod_accum[13][31:0];
-                        PROD[14] <= prod_accum[14][31:0];
-                        PROD[15] <= prod_accum[15][31:0];
-                        busy_bit <= 1'b0;  //busy bit cleared, computation done
-                        done_bit <= 1'b1;  //done bit set, results ready, thus the status register is read as '01' by the software
-                        k <= 3'd0;
+                        //k == N: copy accumulated results to PROD output matrix, ready to be read by C
+                        //(ABC: after the first pass the product only goes into A, see below)
+                        if (run_ops[2] && !(run_chain == CHAIN_ABC && !run_pass))
+                        begin
+                            for (int idx = 0; idx < NN; idx++)
+                            begin
+                                PROD[run_bank][idx] <= run_sat ? sat32(acc_wide[idx]) : acc_wide[idx][31:0];
+                                PROD_HI[run_bank][idx] <= acc_wide[idx][63:32];
+                                prod_ovf[run_bank][idx] <= (acc_wide[idx][63:31] != {33{acc_wide[idx][63]}});  //fits in 32 bits only if bits 63..31 are all equal
+                            end
+                        end
+                        if (run_ops[2] && PIPELINE_MAC)
+                        begin
+                            for (int idx = 0; idx < NN; idx++)
+                                prod_accum[idx] <= acc_final[idx];  //the last registered term, for ACCUM chains
+                        end
+
+                        //Chained operations on the finished product
+                        for (int idx = 0; idx < NN; idx++)
+                        begin
+                            if (run_chain == CHAIN_ADD_C)
+                            begin
+                                //the SUM/DIFF adders on PROD and C
+                                //(signed on both sides, so C is sign extended)
+                                if (run_ops[0])
+                                    SUM[run_bank][idx] <= (run_sat ? sat32(acc_wide[idx]) : $signed(acc_wide[idx][31:0])) + C[run_bank][idx];
+                                if (run_ops[1])
+                                    DIFF[run_bank][idx] <= (run_sat ? sat32(acc_wide[idx]) : $signed(acc_wide[idx][31:0])) - C[run_bank][idx];
+                            end
+                            if (run_chain == CHAIN_FEED || (run_chain == CHAIN_ABC && !run_pass))
+                                A[run_bank][idx] <= sat16(acc_wide[idx] >>> run_shift);  //the product is the next A
+                        end
+
+                        if (!queue_job)
+                        begin
+                            bank_ops[run_bank] <= run_ops;  //what the RESULT window shows for this bank
+                            skip_last <= 16'(skip_job);
+                        end
+
+                        k <= '0;
+                        wb_group <= wb_first;
+                        wb_idx <= '0;
+                        if (run_chain == CHAIN_ABC && !run_pass)
+                        begin
+                            //second pass: (fed-back A) × C, all rows valid
+                            run_pass <= 1'b1;
+                            run_rows_a <= '1;
+                            run_rows_b <= '1;
+                        end else if (!dma_job && !stream_job)
+                        begin
+                            busy_bit <= 1'b0;  //busy bit cleared, computation done
+                            done_bit <= 1'b1;  //done bit set, results ready, thus the status register is read as '01' by the software
+                            done_bank[run_bank] <= 1'b1;
+                        end else if (run_accum && !batch_last)
+                        begin
+                            //accumulating batch: no writeback until the last pair, fetch the next one right away
+                            batch_done <= batch_done + 16'd1;
+                            cur_src_a <= cur_src_a + step_a;
+                            cur_src_b <= cur_src_b + step_b;
+                            dma_count <= '0;
+                            fetch_recv <= '0;
+                        end
+                    end
+                end
+
+                //WRITEBACK: 3*NN result words (NN per selected operation) to cur_dst, DONE is only set after the last write is accepted
+                //so the software never sees DONE before the results are in memory
+                //in a batch, the next pair is fetched right after, DONE comes after the last pair
+                WRITEBACK:
+                begin
+                    if (dma_accept && wb_last && stream_job)
+                    begin
+                        busy_bit <= 1'b0;  //result packet sent, no DONE for stream jobs
+                    end else if (dma_accept && wb_last)
+                    begin
+                        batch_done <= batch_done + 16'd1;
+                        if (batch_last)
+                        begin
+                            busy_bit <= 1'b0;
+                            done_bit <= 1'b1;
+                            done_bank[run_bank] <= 1'b1;
+                        end else
+                        begin
+                            cur_src_a <= cur_src_a + step_a;   //next A, NN int16 (or int8) on unless DMA_STEP says otherwise
+                            cur_src_b <= cur_src_b + step_b;   //next B
+                            cur_dst <= cur_dst + 32'(3*NN*4);     //next result block, 3*NN int32
+                            dma_count <= '0;
+                            fetch_recv <= '0;
+                        end
                     end
                 end
                
                 DONE: begin
                     //Just hold results and status, do not reassign anything
                     //it waits for the start signal to go back to LOAD_AB state (check in the nextstate logic, just below)
+                    if (clear_acc)
+                    begin
+                        for (int idx = 0; idx < NN; idx++)
+                            prod_accum[idx] <= '0;
+                        clear_acc <= 1'b0;
+                    end
                 end
                 default: ;
             endcase
         end
     end
 
+    //Operands of the job in progress: the run bank (rows not in ROW_VALID as zero), or the input queue head for a queued job
+    //with TRANS_A/TRANS_B, element idx = [r][c] comes from the stored element [c][r] (ROW_VALID masks stored rows)
+    always_comb begin
+        for (int idx = 0; idx < NN; idx++)
+        begin
+            opA[idx] = queue_job ? jq_a[inq_rd][idx] :
+                       (run_rows_a[src_idx(idx, run_trans_a && !run_pass) / N] ? A[run_bank][src_idx(idx, run_trans_a && !run_pass)] : 16'sd0);
+            opB[idx] = queue_job ? jq_b[inq_rd][idx] :
+                       run_pass ? C[run_bank][idx] :  //ABC second pass
+                       (run_rows_b[src_idx(idx, run_trans_b) / N] ? B[run_bank][src_idx(idx, run_trans_b)] : 16'sd0);
+        end
+    end
+
+    //Zero skip: k term k is live if column k of A and row k of B both have a non-zero element,
+    //k_live_next is the first live k after the current one
+    always_comb begin
+        for (int kk = 0; kk < N; kk++)
+        begin
+            logic a_col_nz, b_row_nz;
+
+            a_col_nz = 1'b0;
+            b_row_nz = 1'b0;
+            for (int i = 0; i < N; i++)
+            begin
+                a_col_nz = a_col_nz | (opA[i*N + kk] != 16'sd0);
+                b_row_nz = b_row_nz | (opB[kk*N + i] != 16'sd0);
+            end
+            k_live[kk] = a_col_nz && b_row_nz;
+        end
+
+        k_live_next = K_W'(N);
+        for (int kk = N - 1; kk >= 0; kk--)
+        begin
+            if (kk > int'(k) && k_live[kk])
+                k_live_next = K_W'(kk);
+        end
+    end
+
+    //Fully parallel multiply (PARALLEL_MUL = 1): C[i][j] = A[i][0]*B[0][j] + ... + A[i][N-1]*B[N-1][j]
+    //the products are 32 bits, the sum is done in 64 bits like the accumulators (synthesis builds the adder tree)
+    //with PARALLEL_MUL = 0 nothing reads full_dot, so synthesis removes it
+    always_comb begin
+        for (int r = 0; r < N; r++)
+        begin
+            for (int c = 0; c < N; c++)
+            begin
+                full_dot[r*N + c] = 64'sd0;
+                for (int kk = 0; kk < N; kk++)
+                    full_dot[r*N + c] = full_dot[r*N + c] + 64'(mul16(opA[r*N + kk], opB[kk*N + c]));
+            end
+        end
+    end
+
+    //MAC array: accumulator value after the RUN cycle at k, one MAC per result element C[r][c] += A[r][k]*B[k][c]
+    //(the accumulators start from zero at k = 0 unless ACCUM), or the whole dot product with PARALLEL_MUL
+    //PIPELINE_MAC: the cycle adds the term registered in the cycle before (none at k = 0, the previous job's
+    //last term was added in its copy cycle), and its own term goes into mul_q
+    always_comb begin
+        for (int r = 0; r < N; r++)
+        begin
+            for (int c = 0; c < N; c++)
+            begin
+                if (PARALLEL_MUL)
+                    mac_term[r*N + c] = ACC_W'(full_dot[r*N + c]);
+                else
+                    mac_term[r*N + c] = ACC_W'(mul16(opA[r*N + k], opB[k*N + c])) +
+                                        //INT8: the k+1 term as well, k is even then (k | 1 keeps the index in range otherwise)
+                                        (run_int8 ? ACC_W'(mul8(opA[r*N + (k | 1'b1)][7:0], opB[(k | 1'b1)*N + c][7:0])) : ACC_W'(0));
+                mac_next[r*N + c] = ((first_k && !run_accum) ? ACC_W'(0) : prod_accum[r*N + c]) +
+                                    (PIPELINE_MAC ? (first_k ? ACC_W'(0) : mul_q[r*N + c]) : mac_term[r*N + c]);
+                acc_final[r*N + c] = PIPELINE_MAC ? prod_accum[r*N + c] + mul_q[r*N + c] : prod_accum[r*N + c];
+                acc_wide[r*N + c] = 64'(acc_final[r*N + c]);  //sign extension, acc_final is signed
+            end
+        end
+    end
+
+    //Job queue control
+    assign inq_push = bus_write && (wr_addr == ADDR_W'(JOBQ_OUT_BASE - 1)) && (inq_count != JQ_CW'(JQ_DEPTH));
+    assign outq_pop = bus_write && (wr_addr == REG_JOBQ) && byteenable[0] && writedata[0] && (outq_count != '0);
+    assign jobq_flush = bus_write && (wr_addr == REG_JOBQ) && byteenable[0] && writedata[1] && !(queue_job && state == RUN);
+    assign queue_start = (inq_count != '0) && (outq_count != JQ_CW'(JQ_DEPTH));
+    assign q_finish = (state == RUN) && queue_job &&
+                      (PIPELINE_MAC ? (k == K_W'(N)) : ((k != K_W'(N)) && (PARALLEL_MUL || k == K_W'(N - 1))));
+    //another entry behind this one, room for its result (this one takes a result entry now, the host may free one),
+    //and no START or stream job waiting
+    assign q_continue = (inq_count > JQ_CW'(1)) &&
+                        ((outq_count + JQ_CW'(1) - JQ_CW'(outq_pop)) < JQ_CW'(JQ_DEPTH)) &&
+                        !start_bit && !stream_start;
+
     //Next‑state combinational logic
     always_comb begin
         nextstate = state;
         case (state)
             LOAD_AB: begin
                 if (start_bit)
+                    nextstate = dma_bit ? FETCH : RUN;
+                else if (stream_start)
+                    nextstate = FETCH;
+                else if (queue_start)
+                    nextstate = RUN;
+            end
+            FETCH: begin
+                if (fetch_valid && fetch_idx == fetch_words - 1'b1)  //last operand word arriving
                     nextstate = RUN;
             end
             RUN: begin
-                if (k == 3'd4)
-                    nextstate = DONE;
+                if (queue_job)
+                begin
+                    if (q_finish)
+                        nextstate = q_continue ? RUN : LOAD_AB;
+                end else if (k == K_W'(N))
+                begin
+                    if (run_chain == CHAIN_ABC && !run_pass)
+                        nextstate = RUN;  //second pass
+                    else if (!dma_job && !stream_job)
+                        nextstate = DONE;
+                    else
+                        nextstate = (run_accum && !batch_last) ? FETCH : WRITEBACK;
+                end
+            end
+            WRITEBACK: begin
+                if (dma_accept && wb_last)  //last result word accepted
+                    nextstate = (batch_last || stream_job) ? DONE : FETCH;
             end
             DONE: begin
-                if (start_bit)
+                if (start_bit || stream_start || queue_start)
                     nextstate = LOAD_AB;
             end
+            default: nextstate = LOAD_AB;
+        endcase
+    end
+
+    //DMA master outputs
+    //FETCH issues read commands 0..NN-1 (first half A words, second half B words, not issued with REUSE_B), WRITEBACK issues one
+    //write per element of each selected result matrix; the address and data are held while waitrequest is high
+    assign fetch_a_words = run_int8 ? CNT_W'(QUARTER) : CNT_W'(HALF);
+    assign fetch_words = run_reuse_b ? fetch_a_words : 2*fetch_a_words;
+    assign src_stride = run_int8 ? 32'(NN) : 32'(NN*2);
+
+    //Strided fetch: word w of a matrix is word (w mod row_words) of row (w / row_words), rows stride bytes apart
+    assign row_words = run_int8 ? CNT_W'((N >= 4) ? N/4 : 1) : CNT_W'(N/2);
+    assign fetch_a_addr = (dma_stride_a == 32'd0) ? cur_src_a + 32'(dma_count) * 32'd4 :
+                          cur_src_a + 32'(dma_count / row_words) * dma_stride_a + 32'(dma_count % row_words) * 32'd4;
+    assign fetch_b_addr = (dma_stride_b == 32'd0) ? cur_src_b + 32'(dma_count - fetch_a_words) * 32'd4 :
+                          cur_src_b + 32'((dma_count - fetch_a_words) / row_words) * dma_stride_b +
+                          32'((dma_count - fetch_a_words) % row_words) * 32'd4;
+
+    //Batch step from one pair to the next, per DMA_STEP field
+    always_comb begin
+        case (dma_step[1:0])
+            STEP_RIGHT: step_a = run_int8 ? 32'(N) : 32'(N*2);
+            STEP_DOWN: step_a = (dma_stride_a == 32'd0) ? src_stride : 32'(N) * dma_stride_a;
+            default: step_a = src_stride;
         endcase
+        case (dma_step[3:2])
+            STEP_RIGHT: step_b = run_int8 ? 32'(N) : 32'(N*2);
+            STEP_DOWN: step_b = (dma_stride_b == 32'd0) ? src_stride : 32'(N) * dma_stride_b;
+            default: step_b = src_stride;
+        endcase
+    end
+    assign dma_read = (state == FETCH) && dma_job && (dma_count < fetch_words);
+    assign dma_write = (state == WRITEBACK) && dma_job;
+    assign dma_byteenable = 4'hF;
+    //a result word is taken by the master or (stream job) by the sink behind the source
+    assign dma_accept = ((dma_read || dma_write) && !dma_waitrequest) || (aso_valid && aso_ready);
+
+    //Avalon-ST: the sink is ready while a stream job collects its operands, the source sends the
+    //same word sequence as the DMA writeback; dma_writedata/wb_* are shared with the DMA path
+    assign stream_start = stream_en && asi_valid;
+    assign asi_ready = (state == FETCH) && stream_job;
+    assign aso_valid = (state == WRITEBACK) && stream_job;
+    assign aso_data = dma_writedata;
+    assign aso_startofpacket = aso_valid && (wb_group == wb_first) && (wb_idx == '0);
+    assign aso_endofpacket = aso_valid && wb_last;
+
+    //FETCH input: DMA read data, or sink beats (startofpacket restarts at word 0)
+    assign fetch_valid = stream_job ? (asi_valid && asi_ready) : dma_readdatavalid;
+    assign fetch_data = stream_job ? asi_data : dma_readdata;
+    assign fetch_idx = (stream_job && asi_startofpacket) ? CNT_W'(0) : fetch_recv;
+    assign batch_last = (batch_done + 16'd1 >= batch_count);  //also true for BATCH_COUNT = 0
+
+    assign irq = irq_enable && irq_pending;
+
+    //WRITEBACK order with the operation mask: the selected matrices of SUM, DIFF and PROD, in that order,
+    //each at its place in the result block; run_ops is never 0, so there is always a first one
+    assign wb_first = run_ops[0] ? 2'd0 : (run_ops[1] ? 2'd1 : 2'd2);
+    assign wb_next = (wb_group == 2'd0 && run_ops[1]) ? 2'd1 : 2'd2;  //only used when a later matrix is selected
+    assign wb_last = (wb_idx == IDX_W'(NN - 1)) &&
+                     ((wb_group == 2'd2) ||
+                      (wb_group == 2'd1 && !run_ops[2]) ||
+                      (wb_group == 2'd0 && run_ops[2:1] == 2'b00));
+
+    always_comb begin
+        dma_address = 32'd0;
+        dma_writedata = 32'd0;
+        if (state == FETCH)
+        begin
+            if (dma_count < fetch_a_words)
+                dma_address = fetch_a_addr;
+            else
+                dma_address = fetch_b_addr;
+        end else
+        begin
+            dma_address = cur_dst + (32'(wb_group) * 32'(NN) + 32'(wb_idx)) * 32'd4;
+            case (wb_group)
+                2'd0: dma_writedata = SUM[run_bank][wb_idx];
+                2'd1: dma_writedata = DIFF[run_bank][wb_idx];
+                default: dma_writedata = PROD[run_bank][wb_idx];
+            endcase
+        end
     end
 
-    //Read logic for Avalon‑MM interface
+    //RESULT window decode: word w of the window -> selected-operation number grp and element,
+    //then grp -> matrix, counting only the operations in the host bank's op mask
     always_comb begin
-        readdata = 32'd0;
-        if (chipselect && read) 
+        int w, nsel, grp, elem, cnt;
+
+        w = int'(rd_addr) - RES_BASE;
+        nsel = int'(bank_ops[host_bank][0]) + int'(bank_ops[host_bank][1]) + int'(bank_ops[host_bank][2]);
+        if (res_interleave)
         begin
-            case (address)
-                //Read SUM matrix (addresses 32..47)
-                8'd32: readdata = SUM[0];
-                8'd33: readdata = SUM[1];
-                8'd34: readdata = SUM[2];
-                8'd35: readdata = SUM[3];
-                8'd36: readdata = SUM[4];
-                8'd37: readdata = SUM[5];
-                8'd38: readdata = SUM[6];
-                8'd39: readdata = SUM[7];
-                8'd40: readdata = SUM[8];
-                8'd41: readdata = SUM[9];
-                8'd42: readdata = SUM[10];
-                8'd43: readdata = SUM[11];
-                8'd44: readdata = SUM[12];
-                8'd45: readdata = SUM[13];
-                8'd46: readdata = SUM[14];
-                8'd47: readdata = SUM[15];
-
-                //Read DIFF matrix (addresses 48..63)
-                8'd48: readdata = DIFF[0];
-                8'd49: readdata = DIFF[1];
-                8'd50: readdata = DIFF[2];
-                8'd51: readdata = DIFF[3];
-                8'd52: readdata = DIFF[4];
-                8'd53: readdata = DIFF[5];
-                8'd54: readdata = DIFF[6];
-                8'd55: readdata = DIFF[7];
-                8'd56: readdata = DIFF[8];
-                8'd57: readdata = DIFF[9];
-                8'd58: readdata = DIFF[10];
-                8'd59: readdata = DIFF[11];
-                8'd60: readdata = DIFF[12];
-                8'd61: readdata = DIFF[13];
-                8'd62: readdata = DIFF[14];
-                8'd63: readdata = DIFF[15];
-
-                //Read PROD matrix (addresses 64..79)
-                8'd64: readdata = PROD[0];
-                8'd65: readdata = PROD[1];
-                8'd66: readdata = PROD[2];
-                8'd67: readdata = PROD[3];
-                8'd68: readdata = PROD[4];
-                8'd69: readdata = PROD[5];
-                8'd70: readdata = PROD[6];
-                8'd71: readdata = PROD[7];
-                8'd72: readdata = PROD[8];
-                8'd73: readdata = PROD[9];
-                8'd74: readdata = PROD[10];
-                8'd75: readdata = PROD[11];
-                8'd76: readdata = PROD[12];
-                8'd77: readdata = PROD[13];
-                8'd78: readdata = PROD[14];
-                8'd79: readdata = PROD[15];
-
-                //Read STATUS (bit1=BUSY, bit0=DONE) at address 81
-                8'd81: readdata = {30'd0, busy_bit, done_bit};
-                default: readdata = 32'd0;
+            //nsel is 1..3 (bank_ops is never 0), divisions by constants only
+            case (nsel)
+                1: begin grp = 0; elem = w; end
+                2: begin grp = w % 2; elem = w / 2; end
+                default: begin grp = w % 3; elem = w / 3; end
             endcase
+        end else
+        begin
+            grp = w / NN;
+            elem = w % NN;
+        end
+        res_valid = (w >= 0) && (w < nsel*NN);
+        res_elem = IDX_W'(elem);
+
+        res_sel = 2'd2;
+        cnt = 0;
+        for (int op = 0; op < 3; op++)
+        begin
+            if (bank_ops[host_bank][op])
+            begin
+                if (cnt == grp)
+                    res_sel = 2'(op);
+                cnt = cnt + 1;
+            end
+        end
+    end
+
+    //Read mux for Avalon‑MM interface, looks at the accepted read address or the current read burst beat
+    always_comb begin
+        rd_mux_data = 32'd0;
+        //Read SUM, DIFF and PROD matrices of the host bank
+        if (rd_addr >= ADDR_W'(SUM_BASE) && rd_addr < ADDR_W'(DIFF_BASE))
+            rd_mux_data = SUM[host_bank][rd_addr - ADDR_W'(SUM_BASE)];
+        else if (rd_addr >= ADDR_W'(DIFF_BASE) && rd_addr < ADDR_W'(PROD_BASE))
+            rd_mux_data = DIFF[host_bank][rd_addr - ADDR_W'(DIFF_BASE)];
+        else if (rd_addr >= ADDR_W'(PROD_BASE) && rd_addr < ADDR_W'(REG_BASE))
+            rd_mux_data = PROD[host_bank][rd_addr - ADDR_W'(PROD_BASE)];
+        //JOBQ_OUT: SUM, DIFF and PROD of the result queue head
+        else if (rd_addr >= ADDR_W'(JOBQ_OUT_BASE) && rd_addr < ADDR_W'(JOBQ_OUT_BASE + NN))
+            rd_mux_data = jq_sum[outq_rd][rd_addr - ADDR_W'(JOBQ_OUT_BASE)];
+        else if (rd_addr >= ADDR_W'(JOBQ_OUT_BASE + NN) && rd_addr < ADDR_W'(JOBQ_OUT_BASE + 2*NN))
+            rd_mux_data = jq_diff[outq_rd][rd_addr - ADDR_W'(JOBQ_OUT_BASE + NN)];
+        else if (rd_addr >= ADDR_W'(JOBQ_OUT_BASE + 2*NN) && rd_addr < ADDR_W'(PROD_HI_BASE))
+            rd_mux_data = jq_prod[outq_rd][rd_addr - ADDR_W'(JOBQ_OUT_BASE + 2*NN)];
+        //PROD_HI and PROD_OVF_MASK of the host bank
+        else if (rd_addr >= ADDR_W'(PROD_HI_BASE) && rd_addr < ADDR_W'(PROD_OVF_BASE))
+            rd_mux_data = PROD_HI[host_bank][rd_addr - ADDR_W'(PROD_HI_BASE)];
+        else if (rd_addr >= ADDR_W'(PROD_OVF_BASE) && rd_addr < ADDR_W'(PERF_BASE))
+        begin
+            for (int b = 0; b < 32; b++)
+                if (32*(rd_addr - ADDR_W'(PROD_OVF_BASE)) + b < NN)
+                    rd_mux_data[b] = prod_ovf[host_bank][32*(rd_addr - ADDR_W'(PROD_OVF_BASE)) + b];
+        end
+        //Performance counters and PERF_CTRL
+        else if (rd_addr >= ADDR_W'(PERF_BASE) && rd_addr < ADDR_W'(PERF_BASE + PERF_COUNT))
+            rd_mux_data = perf[rd_addr - ADDR_W'(PERF_BASE)];
+        else if (rd_addr == ADDR_W'(RES_BASE - 1))
+            rd_mux_data = {30'd0, perf_freeze, 1'b0};
+        //RESULT: the selected results, packed (see res_sel/res_elem above)
+        else if (rd_addr >= ADDR_W'(RES_BASE) && rd_addr < ADDR_W'(MAP_END))
+        begin
+            if (res_valid)
+            begin
+                case (res_sel)
+                    2'd0: rd_mux_data = SUM[host_bank][res_elem];
+                    2'd1: rd_mux_data = DIFF[host_bank][res_elem];
+                    default: rd_mux_data = PROD[host_bank][res_elem];
+                endcase
+            end
+        end
+        else
+        begin
+            case (rd_addr)
+                //Read STATUS (bit14..12=JOBQ_OUT_COUNT, bit10..8=JOBQ_IN_COUNT, bit7=PROD_OVF, bit6=JOBQ_OVERFLOW,
+                //bit5..4=B_VALID1..0, bit3..2=DONE_BANK1..0, bit1=BUSY, bit0=DONE)
+                REG_STATUS: rd_mux_data = {17'd0, 3'(outq_count), 1'b0, 3'(inq_count), (|prod_ovf[host_bank]), jobq_overflow, b_valid, done_bank, busy_bit, done_bit};
+
+                //Read IRQ (bit1=IRQ_PENDING, bit0=IRQ_ENABLE)
+                REG_IRQ: rd_mux_data = {30'd0, irq_pending, irq_enable};
+
+                //Read MODE (bit20..16=CHAIN_SHIFT, bit12=C_SELECT, bit11=ZERO_SKIP, bit10=RES_INTERLEAVE, bit9=SAT_PROD, bit8=INT8,
+                //bit4=STREAM_REUSE_B, bit3..1=STREAM_OPS, bit0=STREAM_EN)
+                REG_MODE: rd_mux_data = {11'd0, mode_chain_shift, 3'd0, mode_c_sel, mode_zero_skip, res_interleave, mode_sat, mode_int8, 3'd0,
+                                         stream_reuse_b, stream_ops, stream_en};
+
+                //DMA address registers read back
+                REG_DMA_SRC_A: rd_mux_data = dma_src_a;
+                REG_DMA_SRC_B: rd_mux_data = dma_src_b;
+                REG_DMA_STRIDE_A: rd_mux_data = dma_stride_a;
+                REG_DMA_STRIDE_B: rd_mux_data = dma_stride_b;
+                REG_DMA_STEP: rd_mux_data = {28'd0, dma_step};
+                REG_DMA_DST: rd_mux_data = dma_dst;
+
+                //Batch registers
+                REG_BATCH_COUNT: rd_mux_data = {16'd0, batch_count};
+                REG_BATCH_DONE: rd_mux_data = {16'd0, batch_done};
+
+                //Job queue depth, so the driver does not have to hardcode it
+                REG_JOBQ: rd_mux_data = 32'(JQ_DEPTH);
+
+                //Zero skip statistics and row-valid mask
+                REG_SKIP_LAST: rd_mux_data = {16'd0, skip_last};
+                REG_SKIP_TOTAL: rd_mux_data = skip_total;
+                REG_ROW_VALID: rd_mux_data = {16'(row_valid_b), 16'(row_valid_a)};
+                default: rd_mux_data = 32'd0;
+            endcase
+        end
+    end
+
+    //Performance counters, separate from the FSM so they never change its behaviour
+    assign perf_ctrl_wr = bus_write && (wr_addr == ADDR_W'(RES_BASE - 1)) && byteenable[0];
+    assign job_start = (state == LOAD_AB) && (start_bit || stream_start || queue_start);
+
+    always_ff @(posedge clk or posedge reset)
+    begin
+        if (reset)
+        begin
+            perf_freeze <= 1'b0;
+            for (int i = 0; i < PERF_COUNT; i++)
+                perf[i] <= 32'd0;
+        end else if (perf_ctrl_wr && writedata[0])
+        begin
+            perf_freeze <= writedata[1];
+            for (int i = 0; i < PERF_COUNT; i++)
+                perf[i] <= 32'd0;  //CLEAR
+        end else
+        begin
+            if (perf_ctrl_wr)
+                perf_freeze <= writedata[1];
+            if (!perf_freeze)
+            begin
+                //cycles per FSM state
+                case (state)
+                    LOAD_AB: perf[PERF_LOAD] <= perf[PERF_LOAD] + 32'd1;
+                    FETCH: perf[PERF_FETCH] <= perf[PERF_FETCH] + 32'd1;
+                    RUN: perf[PERF_RUN] <= perf[PERF_RUN] + 32'd1;
+                    WRITEBACK: perf[PERF_WRITEBACK] <= perf[PERF_WRITEBACK] + 32'd1;
+                    DONE: perf[PERF_DONE] <= perf[PERF_DONE] + 32'd1;
+                    default: ;
+                endcase
+
+                //jobs: picked up in LOAD_AB, or a queued job following the previous one directly
+                if (job_start || (q_finish && q_continue))
+                    perf[PERF_JOBS] <= perf[PERF_JOBS] + 32'd1;
+
+                //bus traffic, read beats as they are returned (bursts count every word)
+                if (readdatavalid)
+                    perf[PERF_BUS_READS] <= perf[PERF_BUS_READS] + 32'd1;
+                if (bus_write)
+                    perf[PERF_BUS_WRITES] <= perf[PERF_BUS_WRITES] + 32'd1;
+                if (dma_read && !dma_waitrequest)
+                    perf[PERF_DMA_READS] <= perf[PERF_DMA_READS] + 32'd1;
+                if (dma_write && !dma_waitrequest)
+                    perf[PERF_DMA_WRITES] <= perf[PERF_DMA_WRITES] + 32'd1;
+
+                //idle: waiting in LOAD_AB/DONE with nothing to pick up
+                if ((state == LOAD_AB || state == DONE) && !job_start && !start_bit && perf[PERF_JOBS] != 32'd0)
+                    perf[PERF_IDLE] <= perf[PERF_IDLE] + 32'd1;
+            end
+        end
+    end
+
+    //Registered read data: one beat per clock, qualified by readdatavalid
+    //registering here takes the read mux out of the path to the interconnect
+    always_ff @(posedge clk or posedge reset)
+    begin
+        if (reset)
+        begin
+            readdata <= 32'd0;
+            readdatavalid <= 1'b0;
+            rd_burst_addr <= '0;
+            rd_burst_left <= 5'd0;
+        end else begin
+            readdatavalid <= 1'b0;
+            if (bus_read)
+            begin
+                readdata <= rd_mux_data;  //first beat, from 'address'
+                readdatavalid <= 1'b1;
+                if (burstcount > 5'd1)
+                begin
+                    rd_burst_addr <= address + 1'b1;
+                    rd_burst_left <= burstcount - 5'd1;
+                end
+            end else if (rd_burst_left != 5'd0)
+            begin
+                readdata <= rd_mux_data;  //remaining beats, from rd_burst_addr
+                readdatavalid <= 1'b1;
+                rd_burst_addr <= rd_burst_addr + 1'b1;
+                rd_burst_left <= rd_burst_left - 5'd1;
+            end
         end
     end
-endmodule
\ No newline at end of file
+endmodule
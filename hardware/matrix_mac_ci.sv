@@ -0,0 +1,99 @@
+//Nios II custom instruction with the accelerator's MAC arithmetic (matrix_mac_pkg), so small products can be
+//computed straight from the CPU's registers, without Avalon-MM loads and stores through the interconnect.
+//It holds NN 64-bit accumulators (16 for N = 4, one per element of C = A×B) and a pointer to the current one.
+//
+// Operands: dataa and datab each carry a packed int16 pair (low half = first element), e.g. A[i][k], A[i][k+1]
+// in dataa and B[k][j], B[k+1][j] in datab, so one DOT2 adds two k terms of C[i][j].
+//
+// Extended opcodes (n):
+//   0 DOT2      – acc[ptr] += dataa.lo*datab.lo + dataa.hi*datab.hi, result = low 32 bits of the new acc[ptr]
+//   1 DOT2_NEXT – same, then ptr = ptr + 1 (last pair of an element, moves on to the next one)
+//   2 CLEAR     – all accumulators = 0, ptr = dataa, result = 0
+//   3 SETPTR    – ptr = dataa (the accumulators keep their values, to continue a sum), result = 0
+//   4 READ_LO   – result = acc[dataa] bits 31..0
+//   5 READ_HI   – result = acc[dataa] bits 63..32
+//   6 READ_SAT  – result = acc[dataa] clamped to the int32 range (like SAT_PROD)
+//   7           – reserved, result = 0
+// A 4×4 product is CLEAR 0, then for each of the 16 elements in row-major order DOT2 (k = 0,1) and
+// DOT2_NEXT (k = 2,3), whose result already is the element: 33 custom instructions, no bus access.
+//
+// Timing: variable multi-cycle custom instruction, the result is registered and done comes one clock
+// after start (Platform Designer: "Variable Multicycle", extended with 3 opcode bits, n[2:0]).
+//
+module matrix_mac_ci #(
+    parameter int N = 4   //matrix dimension, N×N accumulators
+)(
+    input logic clk,
+    input logic reset,
+    input logic clk_en,
+    input logic start,
+    input logic [2:0] n,         //extended opcode
+    input logic [31:0] dataa,
+    input logic [31:0] datab,
+    output logic [31:0] result,
+    output logic done
+);
+
+import matrix_mac_pkg::*;
+
+localparam int NN = N*N;
+localparam int IDX_W = (NN > 1) ? $clog2(NN) : 1;
+
+//Extended opcodes
+localparam logic [2:0] CI_DOT2 = 3'd0;
+localparam logic [2:0] CI_DOT2_NEXT = 3'd1;
+localparam logic [2:0] CI_CLEAR = 3'd2;
+localparam logic [2:0] CI_SETPTR = 3'd3;
+localparam logic [2:0] CI_READ_LO = 3'd4;
+localparam logic [2:0] CI_READ_HI = 3'd5;
+localparam logic [2:0] CI_READ_SAT = 3'd6;
+
+logic signed [63:0] acc [0:NN-1];  //one accumulator per result element
+logic [IDX_W-1:0] ptr;             //accumulator DOT2 works on
+logic [IDX_W-1:0] rd_idx;          //accumulator the READ_* opcodes return
+logic signed [63:0] acc_new;       //acc[ptr] after a DOT2
+
+assign rd_idx = dataa[IDX_W-1:0];
+assign acc_new = acc[ptr] + dot2_16(dataa, datab);
+
+always_ff @(posedge clk or posedge reset)
+    begin
+        if (reset)
+        begin
+            result <= 32'd0;
+            done <= 1'b0;
+            ptr <= '0;
+            for (int i = 0; i < NN; i++)
+                acc[i] <= 64'sd0;
+        end else if (clk_en)
+        begin
+            done <= start;  //every opcode takes one cycle
+            if (start)
+            begin
+                case (n)
+                    CI_DOT2, CI_DOT2_NEXT: begin
+                        acc[ptr] <= acc_new;
+                        result <= acc_new[31:0];
+                        if (n == CI_DOT2_NEXT)
+                            ptr <= (ptr == IDX_W'(NN - 1)) ? '0 : ptr + 1'b1;
+                    end
+                    CI_CLEAR: begin
+                        for (int i = 0; i < NN; i++)
+                            acc[i] <= 64'sd0;
+                        ptr <= rd_idx;
+                        result <= 32'd0;
+                    end
+                    CI_SETPTR: begin
+                        ptr <= rd_idx;
+                        result <= 32'd0;
+                    end
+                    CI_READ_LO: result <= acc[rd_idx][31:0];
+                    CI_READ_HI: result <= acc[rd_idx][63:32];
+                    CI_READ_SAT: result <= sat32(acc[rd_idx]);
+                    default: result <= 32'd0;
+                endcase
+            end
+        end
+    end
+
+endmodule
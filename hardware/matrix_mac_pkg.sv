@@ -0,0 +1,42 @@
+//Multiply-accumulate arithmetic shared by the Avalon-MM accelerator (mat_mul_sub_add_all_parallel_16bit)
+//and the Nios II custom instruction (matrix_mac_ci), so both compute exactly the same products and clamps
+//Add this file before the two modules in Platform Designer / Quartus (it has to be compiled first)
+package matrix_mac_pkg;
+
+    //16×16 signed product, exact in 32 bits
+    function automatic logic signed [31:0] mul16(input logic signed [15:0] a, input logic signed [15:0] b);
+        mul16 = a * b;
+    endfunction
+
+    //8×8 signed product, for the INT8 mode
+    function automatic logic signed [15:0] mul8(input logic signed [7:0] a, input logic signed [7:0] b);
+        mul8 = a * b;
+    endfunction
+
+    //Dot product of two packed int16 pairs (low half = first element, the packing of A_PACKED/B_PACKED),
+    //in 64 bits like the accumulators
+    function automatic logic signed [63:0] dot2_16(input logic [31:0] a_pair, input logic [31:0] b_pair);
+        dot2_16 = 64'(mul16(a_pair[15:0], b_pair[15:0])) + 64'(mul16(a_pair[31:16], b_pair[31:16]));
+    endfunction
+
+    //Clamps a 64-bit accumulator to the int32 range, for SAT_PROD
+    function automatic logic signed [31:0] sat32(input logic signed [63:0] v);
+        if (v > 64'sd2147483647)
+            sat32 = 32'sh7FFFFFFF;
+        else if (v < -64'sd2147483648)
+            sat32 = 32'sh80000000;
+        else
+            sat32 = v[31:0];
+    endfunction
+
+    //Clamps a value to the int16 range, for feeding a product back in as an operand
+    function automatic logic signed [15:0] sat16(input logic signed [63:0] v);
+        if (v > 64'sd32767)
+            sat16 = 16'sh7FFF;
+        else if (v < -64'sd32768)
+            sat16 = 16'sh8000;
+        else
+            sat16 = v[15:0];
+    endfunction
+
+endpackage
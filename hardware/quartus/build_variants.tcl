@@ -0,0 +1,193 @@
+# Builds mat_mul_sub_add_all_parallel_16bit standalone in several parameter variants and reports Fmax,
+# ALM/register/DSP usage and power for each, for the DE1-SoC's Cyclone V (5CSEMA5F31C6).
+#
+# Usage (from this directory, Quartus Prime in the PATH):
+#   quartus_sh -t build_variants.tcl                   all variants
+#   quartus_sh -t build_variants.tcl base pipe_acc34   only the named ones
+# Environment: MATRIX_TARGET_MHZ = clock target for the fitter and timing analysis (default 100)
+#
+# Every variant gets its own project in build/<variant>/ (the top-level ports are virtual pins, so the
+# numbers are those of the accelerator alone, without I/O). The results are printed and written to
+# build/results.csv, one line per variant:
+#   variant,PARALLEL_MUL,PIPELINE_MAC,ACC_W,fmax_mhz,alms,registers,dsp_blocks,power_mw,slack_ns
+# fmax_mhz is the restricted Fmax of the slowest timing corner, slack_ns the setup slack at the target.
+
+load_package flow
+
+set script_dir [file dirname [file normalize [info script]]]
+set hw_dir [file dirname $script_dir]
+set build_dir [file join $script_dir build]
+
+# name PARALLEL_MUL PIPELINE_MAC ACC_W
+set variants {
+    {base           0 0 64}
+    {pipe           0 1 64}
+    {acc34          0 0 34}
+    {pipe_acc34     0 1 34}
+    {parallel       1 0 64}
+    {parallel_pipe  1 1 40}
+}
+
+set device 5CSEMA5F31C6
+set top mat_mul_sub_add_all_parallel_16bit
+
+# The package has to come before the modules that import it
+set sources [list \
+    [file join $hw_dir matrix_mac_pkg.sv] \
+    [file join $hw_dir matrix_accelerator_avalonmm.sv] \
+]
+
+# Value of a "<label> : <value>" line of a .summary report file, "" if not found
+proc report_value {file label} {
+    if {![file exists $file]} {
+        return ""
+    }
+    set fh [open $file r]
+    set text [read $fh]
+    close $fh
+    foreach line [split $text "\n"] {
+        set pos [string first " : " $line]
+        if {$pos > 0 && [string trim [string range $line 0 [expr {$pos - 1}]]] eq $label} {
+            return [string trim [string range $line [expr {$pos + 3}] end]]
+        }
+    }
+    return ""
+}
+
+# Leading number of a report value such as "1,234 / 32,070 ( 4 % )" or "411.92 mW"
+proc leading_number {value} {
+    if {[regexp {^([0-9,.]+)} $value -> num]} {
+        return [string map {, ""} $num]
+    }
+    return ""
+}
+
+# Lowest restricted Fmax of clk over all timing corners of the .sta.rpt
+proc worst_fmax {file} {
+    if {![file exists $file]} {
+        return ""
+    }
+    set fh [open $file r]
+    set text [read $fh]
+    close $fh
+    set worst ""
+    foreach {-> fmax restricted} [regexp -all -inline {; ([0-9.]+) MHz +; ([0-9.]+) MHz +; clk +;} $text] {
+        if {$worst eq "" || $restricted < $worst} {
+            set worst $restricted
+        }
+    }
+    return $worst
+}
+
+# Worst setup slack of clk over all corners (the clk line of each "... Model Setup Summary" table)
+proc worst_setup_slack {file} {
+    if {![file exists $file]} {
+        return ""
+    }
+    set fh [open $file r]
+    set text [read $fh]
+    close $fh
+    set worst ""
+    foreach {-> slack} [regexp -all -inline {Setup Summary[^\n]*\n(?:[^\n]*\n){0,3}?; clk +; (-?[0-9.]+) +;} $text] {
+        if {$worst eq "" || $slack < $worst} {
+            set worst $slack
+        }
+    }
+    return $worst
+}
+
+proc build_variant {name parallel pipeline acc_w} {
+    global build_dir script_dir sources device top
+
+    set dir [file join $build_dir $name]
+    file mkdir $dir
+    set old_dir [pwd]
+    cd $dir
+
+    project_new $top -revision $name -overwrite
+    set_global_assignment -name FAMILY "Cyclone V"
+    set_global_assignment -name DEVICE $device
+    set_global_assignment -name TOP_LEVEL_ENTITY $top
+    foreach src $sources {
+        set_global_assignment -name SYSTEMVERILOG_FILE $src
+    }
+    set_global_assignment -name SDC_FILE [file join $script_dir matrix_accel.sdc]
+    set_parameter -name PARALLEL_MUL $parallel
+    set_parameter -name PIPELINE_MAC $pipeline
+    set_parameter -name ACC_W $acc_w
+
+    # standalone build: no pins, the ports would be connected inside the Platform Designer system
+    set_instance_assignment -name VIRTUAL_PIN ON -to *
+    set_instance_assignment -name VIRTUAL_PIN OFF -to clk
+    set_instance_assignment -name VIRTUAL_PIN OFF -to reset
+
+    set_global_assignment -name OPTIMIZATION_MODE "HIGH PERFORMANCE EFFORT"
+    # vectorless power estimate at the default toggle rate
+    set_global_assignment -name POWER_DEFAULT_TOGGLE_RATE "12.5%"
+    set_global_assignment -name POWER_USE_INPUT_FILES OFF
+
+    set ok 1
+    if {[catch {
+        execute_module -tool map
+        execute_module -tool fit
+        execute_module -tool sta
+        execute_module -tool pow
+    } err]} {
+        puts "ERROR: variant $name failed: $err"
+        set ok 0
+    }
+    project_close
+    cd $old_dir
+
+    set rpt [file join $dir output_files $name]
+    if {![file exists ${rpt}.fit.summary]} {
+        set rpt [file join $dir $name]  ;# older Quartus versions put the reports next to the project
+    }
+    set alms [leading_number [report_value ${rpt}.fit.summary "Logic utilization (in ALMs)"]]
+    set regs [leading_number [report_value ${rpt}.fit.summary "Total registers"]]
+    set dsps [leading_number [report_value ${rpt}.fit.summary "Total DSP Blocks"]]
+    set power [leading_number [report_value ${rpt}.pow.summary "Total Thermal Power Dissipation"]]
+    set fmax [worst_fmax ${rpt}.sta.rpt]
+    set slack [worst_setup_slack ${rpt}.sta.rpt]
+    if {!$ok} {
+        set fmax "FAILED"
+    }
+    return [list $name $parallel $pipeline $acc_w $fmax $alms $regs $dsps $power $slack]
+}
+
+# Variants to build: all of them, or the ones named on the command line
+set selected $variants
+if {[llength $quartus(args)] > 0} {
+    set selected {}
+    foreach arg $quartus(args) {
+        set found 0
+        foreach v $variants {
+            if {[lindex $v 0] eq $arg} {
+                lappend selected $v
+                set found 1
+            }
+        }
+        if {!$found} {
+            puts "ERROR: unknown variant $arg"
+            exit 1
+        }
+    }
+}
+
+file mkdir $build_dir
+set results {}
+foreach v $selected {
+    lassign $v name parallel pipeline acc_w
+    puts "=== $name: PARALLEL_MUL=$parallel PIPELINE_MAC=$pipeline ACC_W=$acc_w"
+    lappend results [build_variant $name $parallel $pipeline $acc_w]
+}
+
+set csv [open [file join $build_dir results.csv] w]
+puts $csv "variant,PARALLEL_MUL,PIPELINE_MAC,ACC_W,fmax_mhz,alms,registers,dsp_blocks,power_mw,slack_ns"
+puts [format "%-14s %4s %4s %5s %10s %8s %8s %5s %10s %9s" variant PAR PIPE ACC_W Fmax(MHz) ALMs regs DSPs power(mW) slack(ns)]
+foreach r $results {
+    puts $csv [join $r ,]
+    puts [format "%-14s %4s %4s %5s %10s %8s %8s %5s %10s %9s" {*}$r]
+}
+close $csv
+puts "results written to [file join $build_dir results.csv]"
@@ -0,0 +1,773 @@
+//Self-checking, cycle-accurate performance testbench for mat_mul_sub_add_all_parallel_16bit
+//
+//It drives the Avalon-MM slave the way the Nios II program does it (one transfer at a time, a few idle
+//cycles of instruction overhead between them, reads blocking until readdatavalid), answers the DMA
+//master from a memory model with a fixed read latency, checks every result against a golden model and
+//prints the cycles per job of each load/readback mode:
+//   single   – 32 element writes, START, STATUS polls, 48 result reads (the original driver)
+//   packed   – 16 packed writes through A_PACKED/B_PACKED, 48 result reads
+//   burst    – one 16-beat write burst for A+B, the RESULT window read in 16-beat bursts
+//   pingpong – packed loads into one bank while the other one computes (hw_matrix_pingpong())
+//   batch    – one DMA START for all jobs, operands and results in the memory model (hw_matrix_batch())
+//   queue    – JOBQ_IN bursts and JOBQ_OUT reads, up to JQ_DEPTH jobs in flight (hw_matrix_queue())
+//   zeroskip – MODE.ZERO_SKIP with block-sparse operands and a random ROW_VALID mask per job (junk left in
+//              the invalid rows), also checks SKIP_LAST against the number of all-zero k steps
+//   feed     – CHAIN_FEED jobs in chains of 4: the first job loads A and B, the others only a new B
+//   abc      – one CHAIN_ABC job per triple, C loaded through the B window with MODE.C_SELECT
+//One line per mode, "TB_RESULT mode=<name> jobs=<n> cycles=<c> cycles_per_job=<x.xx> errors=<e>", so
+//before/after numbers of an RTL change can be diffed directly; the run ends with $fatal on any mismatch.
+//
+//Verilator 5 (needs --timing):
+//   verilator --binary --timing -Wno-fatal --top-module tb_matrix_accelerator \
+//       hardware/matrix_mac_pkg.sv hardware/matrix_accelerator_avalonmm.sv hardware/tb/tb_matrix_accelerator.sv
+//   ./obj_dir/Vtb_matrix_accelerator +jobs=64 +seed=1 +gap=2 +latency=4
+//Questa/ModelSim:
+//   vlog -sv hardware/matrix_mac_pkg.sv hardware/matrix_accelerator_avalonmm.sv hardware/tb/tb_matrix_accelerator.sv
+//   vsim -c tb_matrix_accelerator -do "run -all; quit"
+//Plusargs: +jobs (pairs per mode, default 32), +seed, +gap (idle cycles between host transfers, default 2),
+//+latency (DMA read latency of the memory model, default 4), +stall (percent of DMA cycles with waitrequest)
+
+module tb_matrix_accelerator #(
+    //build variant under test, e.g. verilator -GPIPELINE_MAC=1 -GACC_W=34 (see hardware/quartus/build_variants.tcl)
+    parameter bit PARALLEL_MUL = 1'b0,
+    parameter bit PIPELINE_MAC = 1'b0,
+    parameter int ACC_W = 64
+);
+
+localparam int N = 4;
+localparam int NN = N*N;
+localparam int MAX_JOBS = 256;
+localparam int RES_WORDS = 3*NN;  //SUM, DIFF, PROD per job
+
+//Register map, same numbers as software/matrix_accel_regs.h
+localparam int A_BASE = 0;
+localparam int B_BASE = NN;
+localparam int SUM_BASE = 2*NN;
+localparam int REG_BASE = 5*NN;
+localparam int REG_CONTROL = REG_BASE + 0;
+localparam int REG_STATUS = REG_BASE + 1;
+localparam int REG_MODE = REG_BASE + 3;
+localparam int REG_DMA_SRC_A = REG_BASE + 4;
+localparam int REG_DMA_SRC_B = REG_BASE + 5;
+localparam int REG_DMA_DST = REG_BASE + 6;
+localparam int REG_BATCH_COUNT = REG_BASE + 7;
+localparam int REG_JOBQ = REG_BASE + 9;
+localparam int REG_SKIP_LAST = REG_BASE + 10;
+localparam int REG_ROW_VALID = REG_BASE + 12;
+localparam int A_PACKED_BASE = REG_BASE + 16;
+localparam int B_PACKED_BASE = A_PACKED_BASE + NN/2;
+localparam int JOBQ_IN_BASE = B_PACKED_BASE + NN/2;
+localparam int JOBQ_OUT_BASE = JOBQ_IN_BASE + NN;
+localparam int PROD_HI_BASE = JOBQ_OUT_BASE + 3*NN;
+localparam int PERF_BASE = PROD_HI_BASE + NN + (NN + 31)/32;
+localparam int PERF_CTRL = PERF_BASE + 11;
+localparam int RESULT_BASE = PERF_BASE + 12;
+
+localparam logic [31:0] CONTROL_START = 32'h1;
+localparam logic [31:0] CONTROL_DMA = 32'h2;
+localparam logic [31:0] CONTROL_CHAIN_FEED = 32'd2 << 10;
+localparam logic [31:0] CONTROL_CHAIN_ABC = 32'd3 << 10;
+localparam logic [31:0] STATUS_DONE = 32'h1;
+localparam logic [31:0] MODE_ZERO_SKIP = 32'h800;
+localparam logic [31:0] MODE_C_SELECT = 32'h1000;
+localparam int CHAIN_SHIFT = 7;  //MODE.CHAIN_SHIFT of the feed and abc modes
+localparam logic [31:0] ROW_VALID_ALL = {16'({N{1'b1}}), 16'({N{1'b1}})};
+
+//Memory model for the DMA master: operands at MEM_A/MEM_B, result blocks at MEM_OUT (byte addresses)
+localparam int MEM_WORDS = 65536;
+localparam int MEM_A = 32'h0000_0000;
+localparam int MEM_B = 32'h0001_0000;
+localparam int MEM_OUT = 32'h0002_0000;
+localparam int MAX_LATENCY = 16;
+
+//Clock and reset
+logic clk = 1'b0;
+logic reset = 1'b1;
+always #5 clk = ~clk;  //10 time units per cycle, only the cycle counts matter
+longint unsigned cycle = 0;
+always @(posedge clk) cycle <= cycle + 1;
+
+//Avalon-MM slave side (driven by the host tasks)
+logic chipselect = 1'b0;
+logic read = 1'b0;
+logic write = 1'b0;
+logic [7:0] address = '0;
+logic [31:0] writedata = '0;
+logic [3:0] byteenable = 4'hF;
+logic [4:0] burstcount = 5'd1;
+logic waitrequest;
+logic readdatavalid;
+logic [31:0] readdata;
+
+//DMA master side (answered by the memory model)
+logic [31:0] dma_address;
+logic dma_read;
+logic dma_write;
+logic [31:0] dma_writedata;
+logic [3:0] dma_byteenable;
+logic [31:0] dma_readdata;
+logic dma_readdatavalid;
+logic dma_waitrequest;
+
+logic irq;
+logic asi_ready;
+logic [31:0] aso_data;
+logic aso_valid;
+logic aso_startofpacket;
+logic aso_endofpacket;
+
+mat_mul_sub_add_all_parallel_16bit #(.N(N), .PARALLEL_MUL(PARALLEL_MUL), .PIPELINE_MAC(PIPELINE_MAC), .ACC_W(ACC_W)) dut (
+    .clk(clk),
+    .reset(reset),
+    .chipselect(chipselect),
+    .read(read),
+    .write(write),
+    .address(address),
+    .writedata(writedata),
+    .byteenable(byteenable),
+    .burstcount(burstcount),
+    .waitrequest(waitrequest),
+    .readdatavalid(readdatavalid),
+    .readdata(readdata),
+    .dma_address(dma_address),
+    .dma_read(dma_read),
+    .dma_write(dma_write),
+    .dma_writedata(dma_writedata),
+    .dma_byteenable(dma_byteenable),
+    .dma_readdata(dma_readdata),
+    .dma_readdatavalid(dma_readdatavalid),
+    .dma_waitrequest(dma_waitrequest),
+    .irq(irq),
+    .asi_data(32'd0),
+    .asi_valid(1'b0),  //the stream interface is not used here
+    .asi_ready(asi_ready),
+    .asi_startofpacket(1'b0),
+    .asi_endofpacket(1'b0),
+    .aso_data(aso_data),
+    .aso_valid(aso_valid),
+    .aso_ready(1'b1),
+    .aso_startofpacket(aso_startofpacket),
+    .aso_endofpacket(aso_endofpacket)
+);
+
+//Settings from plusargs
+int jobs = 32;
+int seed = 1;
+int host_gap = 2;
+int mem_latency = 4;
+int mem_stall = 0;
+int errors = 0;
+
+//------------------------------------------------------------------------------------------------------
+//Memory model: pipelined reads returned in order after mem_latency cycles, writes take effect at once,
+//waitrequest randomly asserted for mem_stall percent of the cycles
+logic [31:0] mem [0:MEM_WORDS-1];
+logic [31:0] rd_pipe_data [0:MAX_LATENCY-1];
+logic rd_pipe_valid [0:MAX_LATENCY-1];
+logic stall_q = 1'b0;
+
+assign dma_waitrequest = stall_q;
+assign dma_readdatavalid = rd_pipe_valid[mem_latency - 1];
+assign dma_readdata = rd_pipe_data[mem_latency - 1];
+
+//the testbench preloads operands through mem_load_* (one word per cycle, before the timed part)
+logic mem_load_en = 1'b0;
+logic [15:0] mem_load_addr = '0;
+logic [31:0] mem_load_data = '0;
+
+always @(posedge clk)
+begin
+    if (reset)
+    begin
+        stall_q <= 1'b0;
+        for (int i = 0; i < MAX_LATENCY; i++)
+        begin
+            rd_pipe_valid[i] <= 1'b0;
+            rd_pipe_data[i] <= 32'd0;
+        end
+    end else
+    begin
+        stall_q <= (mem_stall > 0) && (($urandom % 100) < mem_stall);
+        for (int i = MAX_LATENCY - 1; i > 0; i--)
+        begin
+            rd_pipe_valid[i] <= rd_pipe_valid[i - 1];
+            rd_pipe_data[i] <= rd_pipe_data[i - 1];
+        end
+        rd_pipe_valid[0] <= dma_read && !dma_waitrequest;
+        rd_pipe_data[0] <= mem[dma_address[17:2]];
+    end
+    if (dma_write && !dma_waitrequest)
+        mem[dma_address[17:2]] <= dma_writedata;
+    else if (mem_load_en)
+        mem[mem_load_addr] <= mem_load_data;
+end
+
+task automatic mem_load(input int word, input logic [31:0] data);
+    @(negedge clk);
+    mem_load_en = 1'b1;
+    mem_load_addr = 16'(word);
+    mem_load_data = data;
+    @(negedge clk);
+    mem_load_en = 1'b0;
+endtask
+
+//------------------------------------------------------------------------------------------------------
+//Host bus functional model: signals change at the falling edge and are taken by the DUT at the next
+//rising edge; waitrequest and readdatavalid are registered in the DUT, so they are stable at the falling edge
+
+//Instruction overhead between two transfers of the Nios II
+task automatic host_idle(input int n);
+    repeat (n) @(negedge clk);
+endtask
+
+task automatic mm_write(input int addr, input logic [31:0] data);
+    @(negedge clk);
+    chipselect = 1'b1;
+    write = 1'b1;
+    address = 8'(addr);
+    writedata = data;
+    byteenable = 4'hF;
+    burstcount = 5'd1;
+    while (waitrequest)
+        @(negedge clk);
+    @(negedge clk);  //taken at the rising edge in between
+    chipselect = 1'b0;
+    write = 1'b0;
+    host_idle(host_gap);
+endtask
+
+//Write burst of n words (n <= 16), one beat per cycle while waitrequest is low
+task automatic mm_write_burst(input int addr, input logic [31:0] data [], input int first, input int n);
+    @(negedge clk);
+    chipselect = 1'b1;
+    write = 1'b1;
+    address = 8'(addr);
+    byteenable = 4'hF;
+    burstcount = 5'(n);
+    for (int i = 0; i < n; i++)
+    begin
+        writedata = data[first + i];
+        while (waitrequest)
+            @(negedge clk);
+        @(negedge clk);
+    end
+    chipselect = 1'b0;
+    write = 1'b0;
+    burstcount = 5'd1;
+    host_idle(host_gap);
+endtask
+
+//Blocking read, like an ldwio: the CPU waits for readdatavalid before it goes on
+task automatic mm_read(input int addr, output logic [31:0] data);
+    @(negedge clk);
+    chipselect = 1'b1;
+    read = 1'b1;
+    address = 8'(addr);
+    burstcount = 5'd1;
+    while (waitrequest)
+        @(negedge clk);
+    @(negedge clk);
+    chipselect = 1'b0;
+    read = 1'b0;
+    while (!readdatavalid)
+        @(negedge clk);
+    data = readdata;
+    host_idle(host_gap);
+endtask
+
+//Read burst of n words (n <= 16), what a cache line fill or a DMA descriptor does
+task automatic mm_read_burst(input int addr, input int n, ref logic [31:0] data [$]);
+    int got;
+    @(negedge clk);
+    chipselect = 1'b1;
+    read = 1'b1;
+    address = 8'(addr);
+    burstcount = 5'(n);
+    while (waitrequest)
+        @(negedge clk);
+    @(negedge clk);
+    chipselect = 1'b0;
+    read = 1'b0;
+    burstcount = 5'd1;
+    got = 0;
+    while (got < n)
+    begin
+        if (readdatavalid)
+        begin
+            data.push_back(readdata);
+            got++;
+        end
+        if (got < n)
+            @(negedge clk);
+    end
+    host_idle(host_gap);
+endtask
+
+//Polls STATUS until all bits of mask are set
+task automatic wait_status(input logic [31:0] mask);
+    logic [31:0] status;
+    do
+        mm_read(REG_STATUS, status);
+    while ((status & mask) != mask);
+endtask
+
+//------------------------------------------------------------------------------------------------------
+//Operands and golden model
+logic signed [15:0] opa [0:MAX_JOBS-1][0:NN-1];
+logic signed [15:0] opb [0:MAX_JOBS-1][0:NN-1];
+logic [31:0] golden [0:MAX_JOBS-1][0:RES_WORDS-1];
+
+//Mostly small values, now and then the int16 extremes, so PROD also wraps around in some jobs
+function automatic logic signed [15:0] rand_elem();
+    case ($urandom % 8)
+        0: rand_elem = 16'sh7FFF;
+        1: rand_elem = 16'sh8000;
+        2: rand_elem = 16'(int'($urandom % 65536));
+        default: rand_elem = 16'(int'($urandom % 201) - 100);
+    endcase
+endfunction
+
+//Golden block of one pair: SUM, DIFF, then PROD as the low 32 bits of the 64-bit dot products (also returned
+//whole in prod, for the chained modes)
+task automatic golden_block(input logic signed [15:0] a [0:NN-1], input logic signed [15:0] b [0:NN-1],
+                            output logic [31:0] g [0:RES_WORDS-1], output longint prod [0:NN-1]);
+    for (int r = 0; r < N; r++)
+    begin
+        for (int c = 0; c < N; c++)
+        begin
+            longint acc = 0;
+            for (int k = 0; k < N; k++)
+                acc += longint'(a[r*N + k]) * longint'(b[k*N + c]);
+            g[r*N + c] = 32'(int'(a[r*N + c]) + int'(b[r*N + c]));
+            g[NN + r*N + c] = 32'(int'(a[r*N + c]) - int'(b[r*N + c]));
+            g[2*NN + r*N + c] = acc[31:0];
+            prod[r*N + c] = acc;
+        end
+    end
+endtask
+
+//A product fed back as an operand: arithmetic shift, then clamped to int16
+function automatic logic signed [15:0] feed_elem(input longint v, input int shift);
+    longint q = v >>> shift;
+    feed_elem = (q > 32767) ? 16'sh7FFF : (q < -32768) ? 16'sh8000 : 16'(q);
+endfunction
+
+task automatic make_jobs();
+    longint prod [0:NN-1];
+    for (int j = 0; j < jobs; j++)
+    begin
+        for (int i = 0; i < NN; i++)
+        begin
+            opa[j][i] = rand_elem();
+            opb[j][i] = rand_elem();
+        end
+        golden_block(opa[j], opb[j], golden[j], prod);
+    end
+endtask
+
+function automatic logic [31:0] pack_pair(input logic signed [15:0] lo, input logic signed [15:0] hi);
+    pack_pair = {hi, lo};
+endfunction
+
+//Compares one 48-word result block with an expected one
+task automatic check_words(input string mode, input int j, input logic [31:0] got [0:RES_WORDS-1],
+                           input logic [31:0] expected [0:RES_WORDS-1]);
+    for (int w = 0; w < RES_WORDS; w++)
+    begin
+        if (got[w] !== expected[w])
+        begin
+            errors++;
+            if (errors <= 20)
+                $display("MISMATCH mode=%s job=%0d word=%0d got=%08h expected=%08h", mode, j, w, got[w], expected[w]);
+        end
+    end
+endtask
+
+//Compares one 48-word result block with the golden model of job j
+task automatic check_block(input string mode, input int j, input logic [31:0] got [0:RES_WORDS-1]);
+    check_words(mode, j, got, golden[j]);
+endtask
+
+//------------------------------------------------------------------------------------------------------
+//Load and readback paths of the driver
+task automatic load_elements(input int j);
+    for (int i = 0; i < NN; i++)
+        mm_write(A_BASE + i, 32'(opa[j][i]));
+    for (int i = 0; i < NN; i++)
+        mm_write(B_BASE + i, 32'(opb[j][i]));
+endtask
+
+task automatic load_packed_a(input logic signed [15:0] a [0:NN-1]);
+    for (int w = 0; w < NN/2; w++)
+        mm_write(A_PACKED_BASE + w, pack_pair(a[2*w], a[2*w + 1]));
+endtask
+
+//B_PACKED, or C with MODE.C_SELECT
+task automatic load_packed_b(input logic signed [15:0] b [0:NN-1]);
+    for (int w = 0; w < NN/2; w++)
+        mm_write(B_PACKED_BASE + w, pack_pair(b[2*w], b[2*w + 1]));
+endtask
+
+task automatic load_packed(input int j);
+    load_packed_a(opa[j]);
+    load_packed_b(opb[j]);
+endtask
+
+//A_PACKED and B_PACKED are contiguous, so both fit in one 16-beat burst for N = 4
+task automatic load_packed_burst(input int base, input int j);
+    logic [31:0] words [];
+    words = new[NN];
+    for (int w = 0; w < NN/2; w++)
+    begin
+        words[w] = pack_pair(opa[j][2*w], opa[j][2*w + 1]);
+        words[NN/2 + w] = pack_pair(opb[j][2*w], opb[j][2*w + 1]);
+    end
+    for (int w = 0; w < NN; w += 16)
+        mm_write_burst(base + w, words, w, (NN - w > 16) ? 16 : NN - w);
+endtask
+
+task automatic read_results(input int base, output logic [31:0] got [0:RES_WORDS-1]);
+    for (int w = 0; w < RES_WORDS; w++)
+        mm_read(base + w, got[w]);
+endtask
+
+task automatic read_results_burst(input int base, output logic [31:0] got [0:RES_WORDS-1]);
+    logic [31:0] q [$];
+    for (int w = 0; w < RES_WORDS; w += 16)
+        mm_read_burst(base + w, 16, q);
+    for (int w = 0; w < RES_WORDS; w++)
+        got[w] = q[w];
+endtask
+
+//------------------------------------------------------------------------------------------------------
+//Modes
+task automatic report(input string mode, input longint unsigned cycles, input int errors_before);
+    $display("TB_RESULT mode=%s jobs=%0d cycles=%0d cycles_per_job=%0d.%02d errors=%0d", mode, jobs, cycles,
+             cycles / jobs, (cycles % jobs) * 100 / jobs, errors - errors_before);
+endtask
+
+task automatic run_single(input string mode, input int path);
+    logic [31:0] got [0:RES_WORDS-1];
+    longint unsigned t0;
+    int e0 = errors;
+
+    t0 = cycle;
+    for (int j = 0; j < jobs; j++)
+    begin
+        case (path)
+            0: load_elements(j);
+            1: load_packed(j);
+            default: load_packed_burst(A_PACKED_BASE, j);
+        endcase
+        mm_write(REG_CONTROL, CONTROL_START);
+        wait_status(STATUS_DONE);
+        if (path == 2)
+            read_results_burst(RESULT_BASE, got);  //all three selected, RESULT = SUM, DIFF, PROD
+        else
+            read_results(SUM_BASE, got);
+        check_block(mode, j, got);
+    end
+    report(mode, cycle - t0, e0);
+endtask
+
+//Same sequence as hw_matrix_pingpong()
+task automatic run_pingpong();
+    logic [31:0] got [0:RES_WORDS-1];
+    longint unsigned t0;
+    int e0 = errors;
+    int bank;
+
+    t0 = cycle;
+    mm_write(REG_CONTROL, 32'd0);  //host bank 0, no START
+    load_packed(0);
+    for (int j = 0; j < jobs; j++)
+    begin
+        bank = j & 1;
+        mm_write(REG_CONTROL, CONTROL_START | (32'(bank) << 2) | (32'(bank ^ 1) << 3));
+        if (j > 0)
+        begin
+            wait_status(32'h4 << (bank ^ 1));  //DONE_BANK of the previous pair
+            read_results(SUM_BASE, got);
+            check_block("pingpong", j - 1, got);
+        end
+        if (j + 1 < jobs)
+            load_packed(j + 1);
+    end
+    bank = (jobs - 1) & 1;
+    mm_write(REG_CONTROL, 32'(bank) << 3);
+    wait_status(32'h4 << bank);
+    read_results(SUM_BASE, got);
+    check_block("pingpong", jobs - 1, got);
+    mm_write(REG_CONTROL, 32'd0);
+    report("pingpong", cycle - t0, e0);
+endtask
+
+//One DMA START for the whole batch, as hw_matrix_batch(); the operands are put into the memory model
+//directly (that is the CPU's cache write-back, not accelerator time) and the check reads it back directly
+task automatic run_batch();
+    logic [31:0] got [0:RES_WORDS-1];
+    longint unsigned t0;
+    int e0 = errors;
+
+    for (int j = 0; j < jobs; j++)
+    begin
+        for (int w = 0; w < NN/2; w++)
+        begin
+            mem_load(MEM_A/4 + j*NN/2 + w, pack_pair(opa[j][2*w], opa[j][2*w + 1]));
+            mem_load(MEM_B/4 + j*NN/2 + w, pack_pair(opb[j][2*w], opb[j][2*w + 1]));
+        end
+    end
+
+    t0 = cycle;
+    mm_write(REG_DMA_SRC_A, MEM_A);
+    mm_write(REG_DMA_SRC_B, MEM_B);
+    mm_write(REG_DMA_DST, MEM_OUT);
+    mm_write(REG_BATCH_COUNT, 32'(jobs));
+    mm_write(REG_CONTROL, CONTROL_START | CONTROL_DMA);
+    wait_status(STATUS_DONE);
+    report("batch", cycle - t0, e0);
+
+    for (int j = 0; j < jobs; j++)
+    begin
+        for (int w = 0; w < RES_WORDS; w++)
+            got[w] = mem[MEM_OUT/4 + j*RES_WORDS + w];
+        check_block("batch", j, got);
+    end
+    mm_write(REG_BATCH_COUNT, 32'd1);
+    if (errors != e0)
+        $display("TB_RESULT mode=batch errors=%0d (after the readback)", errors - e0);
+endtask
+
+//Job queue as hw_matrix_queue(): keep the input queue filled, drain the result queue
+task automatic run_queue();
+    logic [31:0] got [0:RES_WORDS-1];
+    logic [31:0] status;
+    longint unsigned t0;
+    int e0 = errors;
+    int pushed = 0;
+    int popped = 0;
+
+    t0 = cycle;
+    mm_write(REG_JOBQ, 32'h2);  //FLUSH
+    while (popped < jobs)
+    begin
+        mm_read(REG_STATUS, status);
+        if (pushed < jobs && ((status >> 8) & 32'h7) < 4)
+        begin
+            load_packed_burst(JOBQ_IN_BASE, pushed);
+            pushed++;
+        end else if (((status >> 12) & 32'h7) > 0)
+        begin
+            read_results_burst(JOBQ_OUT_BASE, got);
+            mm_write(REG_JOBQ, 32'h1);  //POP
+            check_block("queue", popped, got);
+            popped++;
+        end
+    end
+    report("queue", cycle - t0, e0);
+endtask
+
+//ZERO_SKIP and ROW_VALID: every job gets all-zero columns of A / rows of B at random k, and a random
+//row mask; the invalid rows keep their (non-zero) values in the bank, the job has to read them as zero
+task automatic run_zero_skip();
+    logic signed [15:0] a [0:NN-1];
+    logic signed [15:0] b [0:NN-1];
+    logic signed [15:0] ea [0:NN-1];  //what the job sees after ROW_VALID
+    logic signed [15:0] eb [0:NN-1];
+    logic [31:0] expected [0:RES_WORDS-1];
+    logic [31:0] got [0:RES_WORDS-1];
+    longint prod [0:NN-1];
+    logic [N-1:0] rows_a, rows_b;
+    logic [31:0] skip;
+    int exp_skip;
+    longint unsigned t0;
+    int e0 = errors;
+
+    mm_write(REG_MODE, MODE_ZERO_SKIP);
+    t0 = cycle;
+    for (int j = 0; j < jobs; j++)
+    begin
+        a = opa[j];
+        b = opb[j];
+        for (int k = 0; k < N; k++)
+        begin
+            if ($urandom % 2)
+                for (int r = 0; r < N; r++)
+                    a[r*N + k] = 16'sd0;
+            if ($urandom % 2)
+                for (int c = 0; c < N; c++)
+                    b[k*N + c] = 16'sd0;
+        end
+        rows_a = N'($urandom);
+        rows_b = N'($urandom);
+        for (int i = 0; i < NN; i++)
+        begin
+            ea[i] = rows_a[i / N] ? a[i] : 16'sd0;
+            eb[i] = rows_b[i / N] ? b[i] : 16'sd0;
+        end
+
+        load_packed_a(a);
+        load_packed_b(b);
+        mm_write(REG_ROW_VALID, {16'(rows_b), 16'(rows_a)});
+        mm_write(REG_CONTROL, CONTROL_START);
+        wait_status(STATUS_DONE);
+        read_results(SUM_BASE, got);
+        golden_block(ea, eb, expected, prod);
+        check_words("zeroskip", j, got, expected);
+
+        //k = 0 always runs, every later k with an all-zero A column or B row is skipped (not with PARALLEL_MUL)
+        exp_skip = 0;
+        for (int k = 1; k < N; k++)
+        begin
+            logic a_nz = 1'b0;
+            logic b_nz = 1'b0;
+            for (int i = 0; i < N; i++)
+            begin
+                a_nz |= (ea[i*N + k] != 16'sd0);
+                b_nz |= (eb[k*N + i] != 16'sd0);
+            end
+            if (!(a_nz && b_nz))
+                exp_skip++;
+        end
+        if (PARALLEL_MUL)
+            exp_skip = 0;
+        mm_read(REG_SKIP_LAST, skip);
+        if (skip !== 32'(exp_skip))
+        begin
+            errors++;
+            if (errors <= 20)
+                $display("MISMATCH mode=zeroskip job=%0d SKIP_LAST got=%0d expected=%0d", j, skip, exp_skip);
+        end
+    end
+    report("zeroskip", cycle - t0, e0);
+    mm_write(REG_ROW_VALID, ROW_VALID_ALL);
+    mm_write(REG_MODE, 32'd0);
+endtask
+
+//CHAIN_FEED: chains of 4 jobs, each product (>> CHAIN_SHIFT, saturated) is the A of the next job of its chain
+task automatic run_feed();
+    logic signed [15:0] cur_a [0:NN-1];
+    logic [31:0] expected [0:RES_WORDS-1];
+    logic [31:0] got [0:RES_WORDS-1];
+    longint prod [0:NN-1];
+    longint unsigned t0;
+    int e0 = errors;
+
+    mm_write(REG_MODE, 32'(CHAIN_SHIFT) << 16);
+    t0 = cycle;
+    for (int j = 0; j < jobs; j++)
+    begin
+        if (j % 4 == 0)
+        begin
+            cur_a = opa[j];
+            load_packed_a(cur_a);
+        end
+        load_packed_b(opb[j]);
+        mm_write(REG_CONTROL, CONTROL_START | CONTROL_CHAIN_FEED);
+        wait_status(STATUS_DONE);
+        read_results(SUM_BASE, got);
+        golden_block(cur_a, opb[j], expected, prod);  //SUM/DIFF of the A the job started with
+        check_words("feed", j, got, expected);
+        for (int i = 0; i < NN; i++)
+            cur_a[i] = feed_elem(prod[i], CHAIN_SHIFT);
+    end
+    report("feed", cycle - t0, e0);
+    mm_write(REG_MODE, 32'd0);
+endtask
+
+//CHAIN_ABC: PROD = ((A×B) >> CHAIN_SHIFT, saturated) × C in one START, SUM/DIFF of the original A and B;
+//C of job j is the B of the next job
+task automatic run_abc();
+    logic signed [15:0] fed [0:NN-1];
+    logic [31:0] expected [0:RES_WORDS-1];
+    logic [31:0] second [0:RES_WORDS-1];
+    logic [31:0] got [0:RES_WORDS-1];
+    longint prod [0:NN-1];
+    longint unsigned t0;
+    int e0 = errors;
+
+    t0 = cycle;
+    for (int j = 0; j < jobs; j++)
+    begin
+        mm_write(REG_MODE, MODE_C_SELECT | (32'(CHAIN_SHIFT) << 16));
+        load_packed_b(opb[(j + 1) % jobs]);
+        mm_write(REG_MODE, 32'(CHAIN_SHIFT) << 16);
+        load_packed(j);
+        mm_write(REG_CONTROL, CONTROL_START | CONTROL_CHAIN_ABC);
+        wait_status(STATUS_DONE);
+        read_results(SUM_BASE, got);
+
+        golden_block(opa[j], opb[j], expected, prod);
+        for (int i = 0; i < NN; i++)
+            fed[i] = feed_elem(prod[i], CHAIN_SHIFT);
+        golden_block(fed, opb[(j + 1) % jobs], second, prod);
+        for (int i = 2*NN; i < RES_WORDS; i++)
+            expected[i] = second[i];
+        check_words("abc", j, got, expected);
+    end
+    report("abc", cycle - t0, e0);
+    mm_write(REG_MODE, 32'd0);
+endtask
+
+//Accelerator-side view of the last mode: the PERF counters (LOAD, FETCH, RUN, WRITEBACK, DONE, JOBS)
+task automatic print_perf(input string mode);
+    logic [31:0] p [0:5];
+    for (int i = 0; i < 6; i++)
+        mm_read(PERF_BASE + i, p[i]);
+    $display("TB_PERF mode=%s load=%0d fetch=%0d run=%0d writeback=%0d done=%0d jobs=%0d", mode,
+             p[0], p[1], p[2], p[3], p[4], p[5]);
+    mm_write(PERF_CTRL, 32'h1);  //CLEAR for the next mode
+endtask
+
+//------------------------------------------------------------------------------------------------------
+initial
+begin
+    void'($value$plusargs("jobs=%d", jobs));
+    void'($value$plusargs("seed=%d", seed));
+    void'($value$plusargs("gap=%d", host_gap));
+    void'($value$plusargs("latency=%d", mem_latency));
+    void'($value$plusargs("stall=%d", mem_stall));
+    if (jobs < 1 || jobs > MAX_JOBS)
+        $fatal(1, "+jobs must be 1..%0d", MAX_JOBS);
+    if (mem_latency < 1 || mem_latency > MAX_LATENCY)
+        $fatal(1, "+latency must be 1..%0d", MAX_LATENCY);
+    void'($urandom(seed));
+    make_jobs();
+
+    repeat (4) @(negedge clk);
+    reset = 1'b0;
+    host_idle(2);
+
+    run_single("single", 0);
+    print_perf("single");
+    run_single("packed", 1);
+    print_perf("packed");
+    run_single("burst", 2);
+    print_perf("burst");
+    run_pingpong();
+    print_perf("pingpong");
+    run_batch();
+    print_perf("batch");
+    run_queue();
+    print_perf("queue");
+    run_zero_skip();
+    print_perf("zeroskip");
+    run_feed();
+    print_perf("feed");
+    run_abc();
+    print_perf("abc");
+
+    if (errors != 0)
+        $fatal(1, "FAIL: %0d mismatches", errors);
+    $display("PASS: all modes match the golden model (seed %0d)", seed);
+    $finish;
+end
+
+//Watchdog: a hung FSM ends the run instead of simulating forever
+initial
+begin
+    #(64'd2_000_000 * 10 * MAX_JOBS / 32);
+    $fatal(1, "TIMEOUT at cycle %0d", cycle);
+end
+
+endmodule
@@ -0,0 +1,175 @@
+//HPS (ARM Cortex-A9, Linux) benchmark of the matrix accelerator over the lightweight bridge
+//Runs the same random pairs through the CPU and through the accelerator paths of matrix_accel_hps.c,
+//checks the results and prints the time per job
+//  usage: hps_matrix_accel_benchmark [jobs] [/dev/uioN]   (without a UIO device /dev/mem is used, run as root)
+#define _POSIX_C_SOURCE 199309L  //clock_gettime()
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "matrix_accel_hps.h"
+
+#define DEFAULT_JOBS 10000
+
+//Same reference as software_matrix_operations() on the Nios II, in the DMA result block layout
+static void reference_operations(const int16_t *A, const int16_t *B, int32_t *out)
+{
+    int i, j, k;
+
+    for (i = 0; i < ACCEL_NN; i++)
+    {
+        out[i] = (int32_t)A[i] + (int32_t)B[i];
+        out[ACCEL_NN + i] = (int32_t)A[i] - (int32_t)B[i];
+    }
+    for (i = 0; i < ACCEL_N; i++)
+    {
+        for (j = 0; j < ACCEL_N; j++)
+        {
+            int64_t sum = 0;  //64 bits like the accelerator's accumulators, PROD is the low 32 bits
+
+            for (k = 0; k < ACCEL_N; k++)
+            {
+                sum += (int32_t)A[i*ACCEL_N + k] * (int32_t)B[k*ACCEL_N + j];
+            }
+            out[2*ACCEL_NN + i*ACCEL_N + j] = (int32_t)(uint32_t)sum;
+        }
+    }
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+//Counts the result blocks of got that differ from ref
+static size_t count_mismatches(const int32_t *got, const int32_t *ref, size_t jobs)
+{
+    size_t j, bad = 0;
+
+    for (j = 0; j < jobs; j++)
+    {
+        if (memcmp(got + j * DMA_RESULT_WORDS, ref + j * DMA_RESULT_WORDS, DMA_RESULT_WORDS * sizeof(int32_t)) != 0)
+        {
+            bad++;
+        }
+    }
+    return bad;
+}
+
+int main(int argc, char **argv)
+{
+    struct matrix_accel dev;
+    size_t jobs = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 0) : DEFAULT_JOBS;
+    const char *uio_dev = (argc > 2) ? argv[2] : NULL;
+    int16_t *A, *B, *Bsame;
+    int32_t *ref, *ref_same, *out;
+    size_t i, j;
+    double t0, t_sw, t_mmio, t_reuse, t_queue;
+    int err = 0;
+
+    if (jobs == 0)
+    {
+        jobs = DEFAULT_JOBS;
+    }
+
+    A = malloc(jobs * ACCEL_NN * sizeof(int16_t));
+    B = malloc(jobs * ACCEL_NN * sizeof(int16_t));
+    Bsame = malloc(jobs * ACCEL_NN * sizeof(int16_t));
+    ref = malloc(jobs * DMA_RESULT_WORDS * sizeof(int32_t));
+    ref_same = malloc(jobs * DMA_RESULT_WORDS * sizeof(int32_t));
+    out = malloc(jobs * DMA_RESULT_WORDS * sizeof(int32_t));
+    if (A == NULL || B == NULL || Bsame == NULL || ref == NULL || ref_same == NULL || out == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    //Random inputs in the full int16 range (the PROD window keeps the low 32 bits, so does the reference)
+    srand(1);
+    for (i = 0; i < jobs * ACCEL_NN; i++)
+    {
+        A[i] = (int16_t)(rand() & 0xFFFF);
+        B[i] = (int16_t)(rand() & 0xFFFF);
+        Bsame[i] = B[i % ACCEL_NN];  //every pair uses the first B, for the reuse test
+    }
+
+    if (matrix_accel_open(&dev, uio_dev) != 0)
+    {
+        perror(uio_dev ? uio_dev : "/dev/mem");
+        return 1;
+    }
+
+    //Software baseline
+    t0 = now_ns();
+    for (j = 0; j < jobs; j++)
+    {
+        reference_operations(A + j * ACCEL_NN, B + j * ACCEL_NN, ref + j * DMA_RESULT_WORDS);
+    }
+    t_sw = now_ns() - t0;
+    for (j = 0; j < jobs; j++)
+    {
+        reference_operations(A + j * ACCEL_NN, Bsame + j * ACCEL_NN, ref_same + j * DMA_RESULT_WORDS);
+    }
+
+    //One job at a time: load A and B, START, poll, read 48 words
+    t0 = now_ns();
+    for (j = 0; j < jobs && err == 0; j++)
+    {
+        int32_t *o = out + j * DMA_RESULT_WORDS;
+
+        err = matrix_accel_operations(&dev, A + j * ACCEL_NN, B + j * ACCEL_NN, o, o + ACCEL_NN, o + 2 * ACCEL_NN);
+    }
+    t_mmio = now_ns() - t0;
+    if (err == 0)
+    {
+        printf("slave windows : %8.1f ns/job, %zu mismatches\n", t_mmio / jobs, count_mismatches(out, ref, jobs));
+    }
+
+    //B resident, only A per job
+    t0 = now_ns();
+    matrix_accel_load_b(&dev, Bsame);
+    for (j = 0; j < jobs && err == 0; j++)
+    {
+        int32_t *o = out + j * DMA_RESULT_WORDS;
+
+        err = matrix_accel_load_a_and_run_ops(&dev, A + j * ACCEL_NN, OP_ALL, o, o + ACCEL_NN, o + 2 * ACCEL_NN);
+    }
+    t_reuse = now_ns() - t0;
+    if (err == 0)
+    {
+        printf("reuse B       : %8.1f ns/job, %zu mismatches\n", t_reuse / jobs, count_mismatches(out, ref_same, jobs));
+    }
+
+    //Job queues, several jobs in flight
+    if (err == 0)
+    {
+        t0 = now_ns();
+        err = matrix_accel_queue(&dev, A, B, out, jobs);
+        t_queue = now_ns() - t0;
+        if (err == 0)
+        {
+            printf("job queue     : %8.1f ns/job, %zu mismatches\n", t_queue / jobs, count_mismatches(out, ref, jobs));
+        }
+    }
+
+    if (err != 0)
+    {
+        fprintf(stderr, "accelerator did not finish (is the FPGA configured and the bridge enabled?)\n");
+    } else
+    {
+        printf("software      : %8.1f ns/job\n", t_sw / jobs);
+    }
+
+    matrix_accel_close(&dev);
+    free(A);
+    free(B);
+    free(Bsame);
+    free(ref);
+    free(ref_same);
+    free(out);
+    return (err == 0) ? 0 : 1;
+}
@@ -0,0 +1,294 @@
+//Linux userspace driver for the matrix accelerator over the lightweight HPS-to-FPGA bridge
+//Build (on the board or with the ARM cross compiler), together with a program using it:
+//  arm-linux-gnueabihf-gcc -O2 -Wall -o hps_matrix_accel_benchmark hps_matrix_accel_benchmark.c matrix_accel_hps.c
+#define _DEFAULT_SOURCE  //MAP_SHARED etc. with -std=c99
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "matrix_accel_hps.h"
+
+//The /dev/mem mapping uses O_SYNC, so the window is mapped as device memory (uncached, no write combining):
+//every volatile access below goes out on the bridge, in program order, the same as on the Nios II
+//Reads on the bridge are much slower than writes (a read waits for the round trip, writes are posted),
+//so the functions below read STATUS only to poll and read back only the selected results
+
+int matrix_accel_open(struct matrix_accel *dev, const char *uio_dev)
+{
+    size_t span = MATRIX_ACCEL_MAP_WORDS * sizeof(uint32_t);
+    long page = sysconf(_SC_PAGESIZE);
+    off_t phys = 0;
+    size_t in_page = 0;
+
+    dev->fd = -1;
+    dev->map_base = NULL;
+    dev->regs = NULL;
+
+    if (uio_dev == NULL)
+    {
+        //physical address of the accelerator, the mapping has to start on a page boundary
+        phys = (off_t)(LW_BRIDGE_BASE + MATRIX_ACCEL_LW_OFFSET);
+        in_page = (size_t)(phys % page);
+        phys -= (off_t)in_page;
+        dev->fd = open("/dev/mem", O_RDWR | O_SYNC);
+    } else
+    {
+        dev->fd = open(uio_dev, O_RDWR | O_SYNC);  //map 0 of a UIO device is at mmap offset 0
+    }
+    if (dev->fd < 0)
+    {
+        return -1;
+    }
+
+    dev->map_len = in_page + span;
+    dev->map_base = mmap(NULL, dev->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, dev->fd, phys);
+    if (dev->map_base == MAP_FAILED)
+    {
+        int err = errno;
+
+        close(dev->fd);
+        dev->fd = -1;
+        dev->map_base = NULL;
+        errno = err;
+        return -1;
+    }
+    dev->regs = (volatile uint32_t *)((uint8_t *)dev->map_base + in_page);
+    return 0;
+}
+
+void matrix_accel_close(struct matrix_accel *dev)
+{
+    if (dev->map_base != NULL)
+    {
+        munmap(dev->map_base, dev->map_len);
+    }
+    if (dev->fd >= 0)
+    {
+        close(dev->fd);
+    }
+    dev->fd = -1;
+    dev->map_base = NULL;
+    dev->regs = NULL;
+}
+
+//Packed loads, NN/2 words per matrix (8 for N = 4)
+static void load_a_packed(volatile uint32_t *regs, const int16_t *A)
+{
+    int w;
+
+    for (w = 0; w < ACCEL_NN / 2; w++)
+    {
+        regs[A_PACKED_OFFSET + w] = pack_int16_pair(A, w);
+    }
+}
+
+static void load_b_packed(volatile uint32_t *regs, const int16_t *B)
+{
+    int w;
+
+    for (w = 0; w < ACCEL_NN / 2; w++)
+    {
+        regs[B_PACKED_OFFSET + w] = pack_int16_pair(B, w);
+    }
+}
+
+//Polls STATUS until DONE, returns -1 after MATRIX_ACCEL_POLL_LIMIT polls
+static int wait_done(volatile uint32_t *regs)
+{
+    uint32_t polls;
+
+    for (polls = 0; polls < MATRIX_ACCEL_POLL_LIMIT; polls++)
+    {
+        if (regs[STATUS_OFFSET] & STATUS_DONE)
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+//Starts with the given CONTROL bits, waits and reads the selected results from the windows
+static int run_and_read(volatile uint32_t *regs, uint32_t control, uint32_t ops,
+                        int32_t *Sum, int32_t *Diff, int32_t *Prod)
+{
+    int i;
+
+    regs[CONTROL_OFFSET] = CONTROL_START | control | CONTROL_OPS(ops);
+    if (wait_done(regs) != 0)
+    {
+        return -1;
+    }
+
+    if (ops & OP_ADD)
+    {
+        for (i = 0; i < ACCEL_NN; i++)
+        {
+            Sum[i] = (int32_t)regs[SUM_OFFSET + i];
+        }
+    }
+    if (ops & OP_SUB)
+    {
+        for (i = 0; i < ACCEL_NN; i++)
+        {
+            Diff[i] = (int32_t)regs[DIFF_OFFSET + i];
+        }
+    }
+    if (ops & OP_MUL)
+    {
+        for (i = 0; i < ACCEL_NN; i++)
+        {
+            Prod[i] = (int32_t)regs[PROD_OFFSET + i];
+        }
+    }
+    return 0;
+}
+
+int matrix_accel_operations_ops(struct matrix_accel *dev, const int16_t *A, const int16_t *B, uint32_t ops,
+                                int32_t *Sum, int32_t *Diff, int32_t *Prod)
+{
+    ops &= OP_ALL;
+    if (ops == 0)
+    {
+        return 0;  //nothing selected (0 would mean "all" to the hardware)
+    }
+
+    load_a_packed(dev->regs, A);
+    load_b_packed(dev->regs, B);
+    return run_and_read(dev->regs, 0, ops, Sum, Diff, Prod);
+}
+
+int matrix_accel_operations(struct matrix_accel *dev, const int16_t *A, const int16_t *B,
+                            int32_t *Sum, int32_t *Diff, int32_t *Prod)
+{
+    return matrix_accel_operations_ops(dev, A, B, OP_ALL, Sum, Diff, Prod);
+}
+
+void matrix_accel_load_b(struct matrix_accel *dev, const int16_t *B)
+{
+    load_b_packed(dev->regs, B);
+}
+
+int matrix_accel_load_a_and_run_ops(struct matrix_accel *dev, const int16_t *A, uint32_t ops,
+                                    int32_t *Sum, int32_t *Diff, int32_t *Prod)
+{
+    ops &= OP_ALL;
+    if (ops == 0)
+    {
+        return 0;
+    }
+
+    load_a_packed(dev->regs, A);
+    return run_and_read(dev->regs, CONTROL_REUSE_B, ops, Sum, Diff, Prod);
+}
+
+//A plain word loop instead of memcpy(): the mapping is device memory, where the wide or unaligned
+//accesses a libc memcpy() may use are not allowed
+uint32_t matrix_accel_read_results(struct matrix_accel *dev, uint32_t ops, int32_t *out)
+{
+    const volatile uint32_t *res = dev->regs + RESULT_OFFSET;
+    uint32_t *dst = (uint32_t *)out;
+    uint32_t i, words = RESULT_WORDS(ops & OP_ALL);
+
+    for (i = 0; i < words; i++)
+    {
+        dst[i] = res[i];
+    }
+    return words;
+}
+
+int matrix_accel_jobq_push(struct matrix_accel *dev, const int16_t *A, const int16_t *B)
+{
+    volatile uint32_t *regs = dev->regs;
+    int w;
+
+    if (STATUS_JOBQ_IN(regs[STATUS_OFFSET]) >= regs[JOBQ_OFFSET])
+    {
+        return -1;
+    }
+
+    for (w = 0; w < ACCEL_NN / 2; w++)
+    {
+        regs[JOBQ_IN_OFFSET + w] = pack_int16_pair(A, w);
+    }
+    for (w = 0; w < ACCEL_NN / 2; w++)
+    {
+        regs[JOBQ_IN_OFFSET + ACCEL_NN / 2 + w] = pack_int16_pair(B, w);
+    }
+    return 0;
+}
+
+int matrix_accel_jobq_pop(struct matrix_accel *dev, int32_t *out)
+{
+    volatile uint32_t *regs = dev->regs;
+    int i;
+
+    if (STATUS_JOBQ_OUT(regs[STATUS_OFFSET]) == 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < DMA_RESULT_WORDS; i++)
+    {
+        out[i] = (int32_t)regs[JOBQ_OUT_OFFSET + i];
+    }
+    regs[JOBQ_OFFSET] = JOBQ_POP;
+    return 0;
+}
+
+//One STATUS read covers both queues per round, instead of one per push and one per pop
+int matrix_accel_queue(struct matrix_accel *dev, const int16_t *A, const int16_t *B, int32_t *out, size_t n)
+{
+    volatile uint32_t *regs = dev->regs;
+    uint32_t depth;
+    size_t pushed = 0;
+    size_t popped = 0;
+    uint32_t idle_polls = 0;
+
+    regs[JOBQ_OFFSET] = JOBQ_FLUSH;
+    depth = regs[JOBQ_OFFSET];
+
+    while (popped < n)
+    {
+        uint32_t status = regs[STATUS_OFFSET];
+        uint32_t room = depth - STATUS_JOBQ_IN(status);
+        uint32_t ready = STATUS_JOBQ_OUT(status);
+        int w, i;
+
+        if ((room == 0 || pushed == n) && ready == 0)  //nothing to push or pop this round
+        {
+            if (++idle_polls >= MATRIX_ACCEL_POLL_LIMIT)
+            {
+                return -1;
+            }
+            continue;
+        }
+        idle_polls = 0;
+
+        for (; room > 0 && pushed < n; room--, pushed++)
+        {
+            const int16_t *a = A + pushed * ACCEL_NN;
+            const int16_t *b = B + pushed * ACCEL_NN;
+
+            for (w = 0; w < ACCEL_NN / 2; w++)
+            {
+                regs[JOBQ_IN_OFFSET + w] = pack_int16_pair(a, w);
+            }
+            for (w = 0; w < ACCEL_NN / 2; w++)
+            {
+                regs[JOBQ_IN_OFFSET + ACCEL_NN / 2 + w] = pack_int16_pair(b, w);
+            }
+        }
+
+        for (; ready > 0 && popped < pushed; ready--, popped++)
+        {
+            int32_t *o = out + popped * DMA_RESULT_WORDS;
+
+            for (i = 0; i < DMA_RESULT_WORDS; i++)
+            {
+                o[i] = (int32_t)regs[JOBQ_OUT_OFFSET + i];
+            }
+            regs[JOBQ_OFFSET] = JOBQ_POP;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+//Linux userspace driver for the matrix accelerator, for the DE1-SoC's HPS (ARM Cortex-A9)
+//The accelerator's slave is reached through the HPS-to-FPGA lightweight bridge: the register window is
+//mmap'd from /dev/mem (or from a UIO device), so every access is a plain load/store from userspace,
+//no system call per register access; the functions mirror the Nios II ones (hardware_matrix_operations() etc.)
+#ifndef MATRIX_ACCEL_HPS_H
+#define MATRIX_ACCEL_HPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../matrix_accel_regs.h"
+
+//Lightweight HPS-to-FPGA bridge, physical base address as seen from the ARM cores
+#define LW_BRIDGE_BASE 0xFF200000u
+
+//Address of matrix_0 on the h2f_lw_axi_master in Platform Designer (offset from LW_BRIDGE_BASE)
+#ifndef MATRIX_ACCEL_LW_OFFSET
+#define MATRIX_ACCEL_LW_OFFSET 0x00000400u
+#endif
+
+//Polls of STATUS before a function gives up (FPGA not configured, bridge not enabled, ...)
+#ifndef MATRIX_ACCEL_POLL_LIMIT
+#define MATRIX_ACCEL_POLL_LIMIT 10000000u
+#endif
+
+struct matrix_accel
+{
+    int fd;                  //file descriptor of /dev/mem or /dev/uioN
+    void *map_base;          //start of the mapping (page aligned)
+    size_t map_len;          //length of the mapping
+    volatile uint32_t *regs; //the accelerator's word 0
+};
+
+//Maps the accelerator: uio_dev = NULL maps MATRIX_ACCEL_LW_OFFSET of the lightweight bridge from /dev/mem
+//(needs root), otherwise map 0 of the given UIO device (e.g. "/dev/uio0", from a device tree node
+//with compatible = "generic-uio" over the accelerator's span)
+//returns 0 on success, -1 with errno set otherwise
+int matrix_accel_open(struct matrix_accel *dev, const char *uio_dev);
+void matrix_accel_close(struct matrix_accel *dev);
+
+//Single job over the slave windows, same as hardware_matrix_operations()/_ops() on the Nios II
+//returns 0, or -1 if DONE did not come within MATRIX_ACCEL_POLL_LIMIT polls
+int matrix_accel_operations_ops(struct matrix_accel *dev, const int16_t *A, const int16_t *B, uint32_t ops,
+                                int32_t *Sum, int32_t *Diff, int32_t *Prod);
+int matrix_accel_operations(struct matrix_accel *dev, const int16_t *A, const int16_t *B,
+                            int32_t *Sum, int32_t *Diff, int32_t *Prod);
+
+//Operand reuse: B loaded once, then only A per job (REUSE_B)
+void matrix_accel_load_b(struct matrix_accel *dev, const int16_t *B);
+int matrix_accel_load_a_and_run_ops(struct matrix_accel *dev, const int16_t *A, uint32_t ops,
+                                    int32_t *Sum, int32_t *Diff, int32_t *Prod);
+
+//Contiguous readback: copies the RESULT window after a job with op mask ops, RESULT_WORDS(ops) words in the
+//layout selected by MODE_RES_INTERLEAVE, returns the number of words
+uint32_t matrix_accel_read_results(struct matrix_accel *dev, uint32_t ops, int32_t *out);
+
+//Job queues: push returns -1 if the input queue is full, pop returns -1 if no result set is ready;
+//matrix_accel_queue() runs n pairs through the queues (out: n blocks of DMA_RESULT_WORDS words)
+int matrix_accel_jobq_push(struct matrix_accel *dev, const int16_t *A, const int16_t *B);
+int matrix_accel_jobq_pop(struct matrix_accel *dev, int32_t *out);
+int matrix_accel_queue(struct matrix_accel *dev, const int16_t *A, const int16_t *B, int32_t *out, size_t n);
+
+#endif
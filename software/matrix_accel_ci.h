@@ -0,0 +1,77 @@
+//Intrinsics for the matrix MAC custom instruction (hardware/matrix_mac_ci.sv), the bus-free path for small products
+//Build with -DMATRIX_CI_BASE=<opcode base> when the custom instruction is in the system, the base is the
+//ALT_CI_..._N value that Platform Designer puts into system.h for the matrix_mac_ci instance (e.g. ALT_CI_MATRIX_MAC_CI_0_N)
+#ifndef MATRIX_ACCEL_CI_H
+#define MATRIX_ACCEL_CI_H
+
+#include <stdint.h>
+#include "matrix_accel_regs.h"  //ACCEL_N, pack_int16_pair()
+
+#ifdef MATRIX_CI_BASE
+
+//Extended opcodes, see matrix_mac_ci.sv
+#define MATRIX_CI_DOT2 0       //acc[ptr] += a.lo*b.lo + a.hi*b.hi, returns the low 32 bits
+#define MATRIX_CI_DOT2_NEXT 1  //same, then moves ptr to the next accumulator
+#define MATRIX_CI_CLEAR 2      //zero all accumulators, ptr = a
+#define MATRIX_CI_SETPTR 3     //ptr = a, keep the accumulators
+#define MATRIX_CI_READ_LO 4    //low 32 bits of acc[a]
+#define MATRIX_CI_READ_HI 5    //high 32 bits of acc[a]
+#define MATRIX_CI_READ_SAT 6   //acc[a] clamped to int32
+
+//One custom instruction; op must be a constant (the opcode is part of the instruction word)
+#define MATRIX_CI(op, a, b) __builtin_custom_inii(MATRIX_CI_BASE + (op), (int)(a), (int)(b))
+
+#define matrix_ci_dot2(a_pair, b_pair) ((int32_t)MATRIX_CI(MATRIX_CI_DOT2, (a_pair), (b_pair)))
+#define matrix_ci_dot2_next(a_pair, b_pair) ((int32_t)MATRIX_CI(MATRIX_CI_DOT2_NEXT, (a_pair), (b_pair)))
+#define matrix_ci_clear(ptr) ((void)MATRIX_CI(MATRIX_CI_CLEAR, (ptr), 0))
+#define matrix_ci_setptr(ptr) ((void)MATRIX_CI(MATRIX_CI_SETPTR, (ptr), 0))
+#define matrix_ci_read_lo(idx) ((int32_t)MATRIX_CI(MATRIX_CI_READ_LO, (idx), 0))
+#define matrix_ci_read_hi(idx) ((int32_t)MATRIX_CI(MATRIX_CI_READ_HI, (idx), 0))
+#define matrix_ci_read_sat(idx) ((int32_t)MATRIX_CI(MATRIX_CI_READ_SAT, (idx), 0))
+
+//Packs B[k][j] and B[k+1][j] (two rows of one column) like the A row pairs, for the datab operand
+static inline uint32_t pack_int16_column_pair(const int16_t *B, int k, int j)
+{
+    return (uint32_t)(uint16_t)B[k*ACCEL_N + j] | ((uint32_t)(uint16_t)B[(k + 1)*ACCEL_N + j] << 16);
+}
+
+//Prod = A * B (low 32 bits of each 64-bit sum) through the custom instruction, accumulate = 1 adds A * B
+//to the sums already in the accumulators instead (a chain over several calls, like CONTROL_ACCUM)
+//B is repacked column-wise once (ACCEL_NN/2 words), the A row pairs are packed on the fly
+static inline void matrix_ci_mul(const int16_t *A, const int16_t *B, int32_t *Prod, int accumulate)
+{
+    uint32_t bcol[ACCEL_N][ACCEL_N / 2];
+    int i, j, k;
+
+    for (j = 0; j < ACCEL_N; j++)
+    {
+        for (k = 0; k < ACCEL_N; k += 2)
+        {
+            bcol[j][k / 2] = pack_int16_column_pair(B, k, j);
+        }
+    }
+
+    if (accumulate)
+    {
+        matrix_ci_setptr(0);
+    } else
+    {
+        matrix_ci_clear(0);
+    }
+    for (i = 0; i < ACCEL_N; i++)
+    {
+        for (j = 0; j < ACCEL_N; j++)
+        {
+            //the last DOT2 of an element returns it and moves on to the next accumulator
+            for (k = 0; k < ACCEL_N - 2; k += 2)
+            {
+                (void)matrix_ci_dot2(pack_int16_pair(A, (i*ACCEL_N + k) / 2), bcol[j][k / 2]);
+            }
+            Prod[i*ACCEL_N + j] = matrix_ci_dot2_next(pack_int16_pair(A, (i*ACCEL_N + k) / 2), bcol[j][k / 2]);
+        }
+    }
+}
+
+#endif  //MATRIX_CI_BASE
+
+#endif
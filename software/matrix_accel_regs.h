@@ -0,0 +1,168 @@
+//Register map of the matrix accelerator (hardware/matrix_accelerator_avalonmm.sv), shared by the
+//Nios II program (nios2_matrix_accel_benchmark.c) and the HPS library (hps/matrix_accel_hps.c)
+//everything is in words (32-bit) relative to the accelerator's base address
+#ifndef MATRIX_ACCEL_REGS_H
+#define MATRIX_ACCEL_REGS_H
+
+#include <stdint.h>
+
+//Matrix dimension of the accelerator, must match its N parameter in Platform Designer
+#ifndef ACCEL_N
+#define ACCEL_N 4
+#endif
+#define ACCEL_NN (ACCEL_N * ACCEL_N)  //elements per matrix
+
+//Register offsets (word addresses) from the hardware accelerator design
+//the offsets are defined as per the hardware design to access specific registers
+//their descritions are in the mat_mul_sub_add_all_parallel_16bit.sv file (hardware/matrix_accelerator_avalonmm.sv)
+//the map is generated from N there, the addresses in the comments are for N = 4
+#define A_OFFSET 0                   //A[0..15] at addresses 0..15
+#define B_OFFSET (ACCEL_NN)          //B[0..15] at addresses 16..31
+#define SUM_OFFSET (2 * ACCEL_NN)    //SUM[0..15] at addresses 32..47
+#define DIFF_OFFSET (3 * ACCEL_NN)   //DIFF[0..15] at addresses 48..63
+#define PROD_OFFSET (4 * ACCEL_NN)   //PROD[0..15] at addresses 64..79 (32-bit only)
+#define REG_BASE (5 * ACCEL_NN)      //control/status registers from address 80
+#define CONTROL_OFFSET (REG_BASE + 0)   //CONTROL register
+#define STATUS_OFFSET (REG_BASE + 1)    //STATUS register
+#define IRQ_OFFSET (REG_BASE + 2)       //IRQ enable/pending register
+#define MODE_OFFSET (REG_BASE + 3)      //MODE register, streaming setup
+#define DMA_SRC_A_OFFSET (REG_BASE + 4)   //memory address of A for DMA mode
+#define DMA_SRC_B_OFFSET (REG_BASE + 5)   //memory address of B for DMA mode
+#define DMA_DST_OFFSET (REG_BASE + 6)     //memory address of the result block for DMA mode
+#define BATCH_COUNT_OFFSET (REG_BASE + 7) //number of matrix pairs per DMA START
+#define BATCH_DONE_OFFSET (REG_BASE + 8)  //pairs of the current batch already written back
+#define JOBQ_OFFSET (REG_BASE + 9)        //job queue POP/FLUSH, reads the queue depth
+#define SKIP_LAST_OFFSET (REG_BASE + 10)  //MAC cycles the last job saved with ZERO_SKIP
+#define SKIP_TOTAL_OFFSET (REG_BASE + 11) //MAC cycles saved since reset, a write clears it
+#define ROW_VALID_OFFSET (REG_BASE + 12)  //rows of A and B that hold data, the others count as zero
+#define DMA_STRIDE_A_OFFSET (REG_BASE + 13) //bytes between rows of A in memory for DMA mode, 0 = dense
+#define DMA_STRIDE_B_OFFSET (REG_BASE + 14) //same for B
+#define DMA_STEP_OFFSET (REG_BASE + 15)     //where the next pair of a batch starts, DMA_STEP_A()/DMA_STEP_B()
+#define A_PACKED_OFFSET (REG_BASE + 16)                  //A packed two elements per word at addresses 96..103
+#define B_PACKED_OFFSET (A_PACKED_OFFSET + ACCEL_NN / 2) //B packed two elements per word at addresses 104..111
+#define JOBQ_IN_OFFSET (B_PACKED_OFFSET + ACCEL_NN / 2)  //next job queue entry, packed A then B, at addresses 112..127
+#define JOBQ_OUT_OFFSET (JOBQ_IN_OFFSET + ACCEL_NN)      //result queue head SUM, DIFF, PROD at addresses 128..175
+#define PROD_HI_OFFSET (JOBQ_OUT_OFFSET + 3 * ACCEL_NN)  //upper 32 bits of the products at addresses 176..191
+#define PROD_OVF_OFFSET (PROD_HI_OFFSET + ACCEL_NN)      //per-element overflow mask at address 192
+#define PROD_OVF_WORDS ((ACCEL_NN + 31) / 32)            //words of the mask, element 32w+b in bit b of word w
+#define PERF_OFFSET (PROD_OVF_OFFSET + PROD_OVF_WORDS)  //performance counters at addresses 193..203
+#define PERF_CTRL_OFFSET (PERF_OFFSET + 11)              //CLEAR/FREEZE of the counters at address 204
+#define RESULT_OFFSET (PERF_OFFSET + 12)                 //contiguous window of the selected results at addresses 205..252
+#define MATRIX_ACCEL_MAP_WORDS (RESULT_OFFSET + 3 * ACCEL_NN)  //size of the register map, 253 words for N = 4
+//The slave decodes 2^ADDR_W words, so its address span is 256 words = 1 KiB for N = 4 (ADDR_W = 8) and the
+//next power of two above MATRIX_ACCEL_MAP_WORDS words for larger N; instances need span-aligned, non-overlapping bases
+
+//CONTROL register bits
+#define CONTROL_START 0x1   //start the computation
+#define CONTROL_DMA 0x2     //fetch A/B and write the results back over the accelerator's DMA master
+#define CONTROL_RUN_BANK(b) ((uint32_t)(b) << 2)   //operand/result bank the START computes on
+#define CONTROL_HOST_BANK(b) ((uint32_t)(b) << 3)  //bank the matrix windows access from now on
+#define CONTROL_OPS(m) ((uint32_t)(m) << 4)        //operation mask of the START, 0 = all
+#define CONTROL_ACCUM 0x80       //PROD += A * B, the accumulators are not zeroed by this START
+#define CONTROL_CLEAR_ACC 0x100  //zero the accumulators (before the START, if written together)
+#define CONTROL_REUSE_B 0x200    //compute with the B already in the run bank, DMA mode fetches only A
+#define CONTROL_CHAIN(c) ((uint32_t)(c) << 10)     //chained operation of the START, CHAIN_* below
+#define CONTROL_TRANS_A 0x2000   //compute with A transposed (column-major A)
+#define CONTROL_TRANS_B 0x4000   //compute with B transposed (column-major B)
+
+//CONTROL_CHAIN() values (int16 slave/DMA jobs only, PROD is always computed and ACCUM is ignored)
+#define CHAIN_NONE 0
+#define CHAIN_ADD_C 1   //SUM = A * B + C, DIFF = A * B - C
+#define CHAIN_FEED 2    //PROD = A * B, and A = PROD >> CHAIN_SHIFT (int16 saturated) for the next job
+#define CHAIN_ABC 3     //PROD = ((A * B) >> CHAIN_SHIFT) * C in one START
+
+//Operation mask bits, for CONTROL_OPS() and the *_ops() functions
+#define OP_ADD 0x1   //SUM = A + B
+#define OP_SUB 0x2   //DIFF = A - B
+#define OP_MUL 0x4   //PROD = A * B
+#define OP_ALL (OP_ADD | OP_SUB | OP_MUL)
+
+//STATUS register bits
+#define STATUS_DONE 0x1
+#define STATUS_BUSY 0x2
+#define STATUS_DONE_BANK(b) (0x4u << (b))  //job on bank b finished
+#define STATUS_B_VALID(b) (0x10u << (b))   //B of bank b has been loaded since reset
+#define STATUS_JOBQ_OVERFLOW 0x40          //a job queue push was dropped (queue full)
+#define STATUS_PROD_OVF 0x80               //some PROD element of the host bank needs PROD_HI
+#define STATUS_JOBQ_IN(s) (((s) >> 8) & 0x7u)   //jobs waiting in the input queue
+#define STATUS_JOBQ_OUT(s) (((s) >> 12) & 0x7u) //result sets waiting in the result queue
+
+//Performance counters, word index from PERF_OFFSET (32 bits each, they wrap around)
+#define PERF_CYC_LOAD 0       //cycles in LOAD_AB (waiting for or loading the operands)
+#define PERF_CYC_FETCH 1      //cycles fetching operands over DMA/stream
+#define PERF_CYC_RUN 2        //cycles computing
+#define PERF_CYC_WRITEBACK 3  //cycles writing results back over DMA/stream
+#define PERF_CYC_DONE 4       //cycles in DONE
+#define PERF_JOBS 5           //jobs started
+#define PERF_BUS_READS 6      //slave read beats
+#define PERF_BUS_WRITES 7     //slave write beats
+#define PERF_IDLE 8           //cycles with no job running or pending, since the first job
+#define PERF_DMA_READS 9      //DMA master read beats
+#define PERF_DMA_WRITES 10    //DMA master write beats
+#define PERF_COUNTERS 11
+
+//PERF_CTRL register bits
+#define PERF_CTRL_CLEAR 0x1   //zero all counters
+#define PERF_CTRL_FREEZE 0x2  //stop counting while set
+
+//JOBQ register bits (write)
+#define JOBQ_POP 0x1    //drop the result queue head after reading it
+#define JOBQ_FLUSH 0x2  //empty both queues
+
+//ROW_VALID register fields (bit r = row r holds data)
+#define ROW_VALID_A(m) ((uint32_t)(m))
+#define ROW_VALID_B(m) ((uint32_t)(m) << 16)
+#define ROW_VALID_ALL (ROW_VALID_A((1u << ACCEL_N) - 1) | ROW_VALID_B((1u << ACCEL_N) - 1))
+
+//DMA_STEP fields: STEP_NEXT = next dense matrix (NN elements on), STEP_RIGHT = tile to the right
+//(ACCEL_N elements on), STEP_DOWN = tile below (ACCEL_N rows of the stride on)
+#define STEP_NEXT 0
+#define STEP_RIGHT 1
+#define STEP_DOWN 2
+#define DMA_STEP_A(s) ((uint32_t)(s))
+#define DMA_STEP_B(s) ((uint32_t)(s) << 2)
+
+//IRQ register bits
+#define IRQ_ENABLE 0x1
+#define IRQ_PENDING 0x2   //write 1 to clear
+
+//MODE register bits
+#define MODE_STREAM_EN 0x1                        //take jobs from the Avalon-ST sink
+#define MODE_STREAM_OPS(m) ((uint32_t)(m) << 1)   //operation mask of stream jobs, 0 = all
+#define MODE_STREAM_REUSE_B 0x10                  //stream packets carry only A, B stays resident
+#define MODE_INT8 0x100      //int8 operands, four per word in the packed windows / DMA / stream, PROD in half the cycles
+#define MODE_SAT_PROD 0x200  //PROD saturates to the int32 range instead of wrapping
+#define MODE_RES_INTERLEAVE 0x400  //RESULT window element by element (SUM[i], DIFF[i], PROD[i], ...) instead of planar
+#define MODE_ZERO_SKIP 0x800       //skip the MAC cycles of all-zero A columns / B rows
+#define MODE_C_SELECT 0x1000       //the B and B_PACKED windows write C of the host bank instead of B
+#define MODE_CHAIN_SHIFT(s) ((uint32_t)(s) << 16)  //right shift of a product fed back into A (0..31)
+#define MODE_CHAIN_MASK (MODE_C_SELECT | MODE_CHAIN_SHIFT(0x1F))
+#define MODE_STREAM_MASK 0x1F                     //the streaming fields of MODE
+#define MODE_PRECISION_MASK (MODE_INT8 | MODE_SAT_PROD)
+
+//Result block layout written by DMA mode: SUM, DIFF and PROD, ACCEL_NN words each (48 words for N = 4)
+#define DMA_RESULT_WORDS (3 * ACCEL_NN)
+
+//Words of the RESULT window that hold results for an op mask (16 per selected operation for N = 4)
+#define RESULT_WORDS(ops) (((((ops) >> 0) & 1u) + (((ops) >> 1) & 1u) + (((ops) >> 2) & 1u)) * ACCEL_NN)
+
+//Largest batch one START can run (BATCH_COUNT is 16 bits), hw_matrix_batch() splits bigger ones
+#define BATCH_MAX 65535u
+
+//Packs elements 2w and 2w+1 of a 16-bit matrix into one 32-bit bus word
+//element 2w goes in the lower half, element 2w+1 in the upper half, as the packed window expects
+static inline uint32_t pack_int16_pair(const int16_t *M, int w)
+{
+    return (uint32_t)(uint16_t)M[2*w] | ((uint32_t)(uint16_t)M[2*w + 1] << 16);
+    //cast to uint16_t first, so that the sign extension of a negative low element does not
+    //overwrite the upper element
+}
+
+//Packs elements 4w..4w+3 of an int8 matrix into one 32-bit bus word (INT8 mode), element 4w in byte 0
+static inline uint32_t pack_int8_quad(const int8_t *M, int w)
+{
+    return (uint32_t)(uint8_t)M[4*w] | ((uint32_t)(uint8_t)M[4*w + 1] << 8) |
+           ((uint32_t)(uint8_t)M[4*w + 2] << 16) | ((uint32_t)(uint8_t)M[4*w + 3] << 24);
+}
+
+#endif
@@ -0,0 +1,151 @@
+//Result cache for repeated operand pairs, see matrix_result_cache.h
+#include <stdio.h>
+#include <string.h>
+#include "matrix_result_cache.h"
+
+struct result_cache_entry
+{
+    uint32_t hash;   //result_cache_hash() of the operands
+    uint32_t stamp;  //LRU: last use, FIFO: insertion; 0 = empty
+    int16_t A[ACCEL_NN];
+    int16_t B[ACCEL_NN];
+    int32_t Sum[ACCEL_NN];
+    int32_t Diff[ACCEL_NN];
+    int32_t Prod[ACCEL_NN];
+};
+
+static struct result_cache_entry cache[RESULT_CACHE_SETS][RESULT_CACHE_WAYS];
+static uint32_t cache_clock = 0;  //source of the stamps, counts lookups and inserts
+static struct result_cache_stats cache_stats;
+
+//Next stamp; on wraparound the table is emptied, so old stamps can never look newer than new ones
+static uint32_t result_cache_tick(void)
+{
+    if (++cache_clock == 0)
+    {
+        result_cache_clear();
+        cache_clock = 1;
+    }
+    return cache_clock;
+}
+
+//FNV-1a over the operand words, two int16 per step
+uint32_t result_cache_hash(const int16_t *A, const int16_t *B)
+{
+    uint32_t h = 2166136261u;
+    int i;
+
+    for (i = 0; i < ACCEL_NN; i += 2)
+    {
+        h = (h ^ ((uint32_t)(uint16_t)A[i] | ((uint32_t)(uint16_t)A[i + 1] << 16))) * 16777619u;
+    }
+    for (i = 0; i < ACCEL_NN; i += 2)
+    {
+        h = (h ^ ((uint32_t)(uint16_t)B[i] | ((uint32_t)(uint16_t)B[i + 1] << 16))) * 16777619u;
+    }
+    return h;
+}
+
+//Set of a hash: the upper bits, they are mixed best by the last multiply
+static struct result_cache_entry *result_cache_set(uint32_t hash)
+{
+    return cache[(hash >> 16) & (RESULT_CACHE_SETS - 1)];
+}
+
+int result_cache_lookup(uint32_t hash, const int16_t *A, const int16_t *B,
+                        int32_t *Sum, int32_t *Diff, int32_t *Prod)
+{
+    struct result_cache_entry *set = result_cache_set(hash);
+    int w;
+
+    for (w = 0; w < RESULT_CACHE_WAYS; w++)
+    {
+        struct result_cache_entry *e = &set[w];
+
+        if (e->stamp != 0 && e->hash == hash &&
+            memcmp(e->A, A, sizeof(e->A)) == 0 && memcmp(e->B, B, sizeof(e->B)) == 0)
+        {
+            memcpy(Sum, e->Sum, sizeof(e->Sum));
+            memcpy(Diff, e->Diff, sizeof(e->Diff));
+            memcpy(Prod, e->Prod, sizeof(e->Prod));
+#if RESULT_CACHE_POLICY == RESULT_CACHE_LRU
+            e->stamp = result_cache_tick();
+#endif
+            cache_stats.hits++;
+            return 1;
+        }
+    }
+    cache_stats.misses++;
+    return 0;
+}
+
+void result_cache_insert(uint32_t hash, const int16_t *A, const int16_t *B,
+                         const int32_t *Sum, const int32_t *Diff, const int32_t *Prod)
+{
+    struct result_cache_entry *set = result_cache_set(hash);
+    struct result_cache_entry *victim = &set[0];
+    uint32_t stamp = result_cache_tick();
+    int w;
+
+    //an empty way if there is one, else the smallest stamp (least recently used, or oldest insertion)
+    for (w = 0; w < RESULT_CACHE_WAYS; w++)
+    {
+        if (set[w].stamp == 0)
+        {
+            victim = &set[w];
+            break;
+        }
+        if (set[w].stamp < victim->stamp)
+        {
+            victim = &set[w];
+        }
+    }
+    if (victim->stamp != 0)
+    {
+        cache_stats.evictions++;
+    }
+
+    victim->hash = hash;
+    victim->stamp = stamp;
+    memcpy(victim->A, A, sizeof(victim->A));
+    memcpy(victim->B, B, sizeof(victim->B));
+    memcpy(victim->Sum, Sum, sizeof(victim->Sum));
+    memcpy(victim->Diff, Diff, sizeof(victim->Diff));
+    memcpy(victim->Prod, Prod, sizeof(victim->Prod));
+}
+
+void result_cache_clear(void)
+{
+    int s, w;
+
+    for (s = 0; s < RESULT_CACHE_SETS; s++)
+    {
+        for (w = 0; w < RESULT_CACHE_WAYS; w++)
+        {
+            cache[s][w].stamp = 0;
+        }
+    }
+}
+
+void result_cache_get_stats(struct result_cache_stats *s)
+{
+    *s = cache_stats;
+}
+
+void result_cache_reset_stats(void)
+{
+    cache_stats.hits = 0;
+    cache_stats.misses = 0;
+    cache_stats.evictions = 0;
+}
+
+void result_cache_print_stats(void)
+{
+    uint32_t lookups = cache_stats.hits + cache_stats.misses;
+    uint32_t rate_x100 = (lookups == 0) ? 0 : (uint32_t)(((uint64_t)cache_stats.hits * 10000 + lookups / 2) / lookups);
+
+    printf("Result cache: %u hits, %u misses (%u.%02u%% hit rate), %u evictions, %d entries, %d-way, %s\n",
+           (unsigned)cache_stats.hits, (unsigned)cache_stats.misses, (unsigned)(rate_x100 / 100), (unsigned)(rate_x100 % 100),
+           (unsigned)cache_stats.evictions, RESULT_CACHE_ENTRIES, RESULT_CACHE_WAYS,
+           (RESULT_CACHE_POLICY == RESULT_CACHE_LRU) ? "LRU" : "FIFO");
+}
@@ -0,0 +1,70 @@
+//Memoization of accelerator results: a small fixed-size table of recent (A, B) operand pairs and their
+//SUM/DIFF/PROD, so a pair that comes again is answered from memory without any bus transfer
+//(used by hardware_matrix_operations_cached() in the benchmark program)
+//
+//Each entry keeps a copy of its operands, a hit is only reported when both matrices are equal element by
+//element (the hash just picks the set and rejects most mismatches early), so there are no false hits.
+//The cached results are those of the accelerator's default mode (int16, wrapping PROD): call
+//result_cache_clear() after changing MODE (hw_set_precision()) or the bit width the results depend on.
+//
+//Compile-time configuration, so the table can be sized to the Nios II on-chip memory:
+//  RESULT_CACHE_ENTRIES – total entries, a power of two (default 16: about 4 KB for N = 4,
+//                          ACCEL_NN*2*2 + ACCEL_NN*3*4 + 8 bytes per entry)
+//  RESULT_CACHE_WAYS    – entries per set, 1 = direct mapped, RESULT_CACHE_ENTRIES = fully associative
+//                          (default 4, must divide RESULT_CACHE_ENTRIES)
+//  RESULT_CACHE_POLICY  – which way of a full set a miss replaces: RESULT_CACHE_LRU (default), the least
+//                          recently used one, or RESULT_CACHE_FIFO, the oldest insertion (no update on hits)
+#ifndef MATRIX_RESULT_CACHE_H
+#define MATRIX_RESULT_CACHE_H
+
+#include <stdint.h>
+#include "matrix_accel_regs.h"  //ACCEL_N, ACCEL_NN
+
+#define RESULT_CACHE_LRU 0
+#define RESULT_CACHE_FIFO 1
+
+#ifndef RESULT_CACHE_ENTRIES
+#define RESULT_CACHE_ENTRIES 16
+#endif
+#ifndef RESULT_CACHE_WAYS
+#define RESULT_CACHE_WAYS 4
+#endif
+#ifndef RESULT_CACHE_POLICY
+#define RESULT_CACHE_POLICY RESULT_CACHE_LRU
+#endif
+
+#define RESULT_CACHE_SETS (RESULT_CACHE_ENTRIES / RESULT_CACHE_WAYS)
+
+#if (RESULT_CACHE_ENTRIES & (RESULT_CACHE_ENTRIES - 1)) != 0 || (RESULT_CACHE_ENTRIES % RESULT_CACHE_WAYS) != 0
+#error "RESULT_CACHE_ENTRIES must be a power of two and a multiple of RESULT_CACHE_WAYS"
+#endif
+
+struct result_cache_stats
+{
+    uint32_t hits;       //lookups answered from the table
+    uint32_t misses;     //lookups that had to go to the accelerator
+    uint32_t evictions;  //valid entries replaced by an insert
+};
+
+//Hash of an operand pair, computed once per call and passed to lookup and insert
+uint32_t result_cache_hash(const int16_t *A, const int16_t *B);
+
+//Copies the cached results of (A, B) to Sum/Diff/Prod and returns 1 on a hit, returns 0 on a miss
+//(the pointers are not touched then); counts the hit or miss
+int result_cache_lookup(uint32_t hash, const int16_t *A, const int16_t *B,
+                        int32_t *Sum, int32_t *Diff, int32_t *Prod);
+
+//Stores the results of (A, B), replacing an entry of its set per RESULT_CACHE_POLICY if the set is full
+void result_cache_insert(uint32_t hash, const int16_t *A, const int16_t *B,
+                         const int32_t *Sum, const int32_t *Diff, const int32_t *Prod);
+
+//Drops all entries (the statistics are kept)
+void result_cache_clear(void);
+
+void result_cache_get_stats(struct result_cache_stats *s);
+void result_cache_reset_stats(void);
+
+//Prints "Result cache: H hits, M misses (R.RR% hit rate), E evictions, <configuration>"
+void result_cache_print_stats(void);
+
+#endif
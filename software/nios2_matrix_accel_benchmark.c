@@ -1,6 +1,15 @@
 #include <inttypes.h> 
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>  //qsort(), for the benchmark suite statistics
+#include <string.h>  //memcpy() for the result window, memcmp()/memset() for the benchmark suite
+#include <sys/alt_cache.h>  //alt_dcache_flush(), for the buffers the accelerator reads and writes over DMA
+#include <sys/alt_irq.h>    //alt_ic_isr_register(), for the accelerator's completion interrupt
+#include "matrix_accel_regs.h"  //register map and bits, shared with the HPS library in hps/
+#include "nios2_profile.h"      //cycle timing of the software and hardware paths (interval timer)
+#include "matrix_accel_ci.h"    //custom-instruction MAC, with -DMATRIX_CI_BASE=ALT_CI_..._N
+#include "matrix_result_cache.h" //memoized results of repeated operand pairs
 
 //Safe input range to avoid overflow in matrix multiplicationprintf("");
 #define SAFE_INPUT_MAX 23170
@@ -9,46 +18,54 @@
 //matrix_0 connected to NIOS II data master at 0x04000400
 #define MATRIX_ACCEL_BASE 0x04000400
 
-//NIOS II Interval Timer Base Address (from Platform Designer)
-#define TIMER_BASE 0xFF202000
+//All accelerator instances (matrix_0, matrix_1, ... from Platform Designer), used by hw_multi_batch_ops()
+//the single-instance functions use MATRIX_ACCEL_BASE; for e.g. two copies build with
+//-DMATRIX_ACCEL_COUNT=2 -DMATRIX_ACCEL_BASE_LIST="0x04000400, 0x04000800"
+//(each instance spans 1 KiB for N = 4, see MATRIX_ACCEL_MAP_WORDS in matrix_accel_regs.h)
+#ifndef MATRIX_ACCEL_COUNT
+#define MATRIX_ACCEL_COUNT 1
+#endif
+#ifndef MATRIX_ACCEL_BASE_LIST
+#define MATRIX_ACCEL_BASE_LIST MATRIX_ACCEL_BASE
+#endif
 
-//Register offsets (word addresses) from the hardware accelerator design
-//the offsets are defined as per the hardware design to access specific registers
-//their descritions are in the mat_mul_sub_add_all_parallel_16bit.sv file
-#define A_OFFSET 0    //A[0..15] at addresses 0..15
-#define B_OFFSET 16   //B[0..15] at addresses 16..31
-#define SUM_OFFSET 32   //SUM[0..15] at addresses 32..47
-#define DIFF_OFFSET 48   //DIFF[0..15] at addresses 48..63
-#define PROD_OFFSET 64   //PROD[0..15] at addresses 64..79 (32-bit only)
-#define CONTROL_OFFSET 80   //CONTROL register
-#define STATUS_OFFSET 81   //STATUS register
+//Accelerator interrupt (from Platform Designer, the IRQ number of matrix_0's interrupt sender)
+#define MATRIX_ACCEL_IRQ 2
+#define MATRIX_ACCEL_IRQ_INTERRUPT_CONTROLLER_ID 0
 
-void software_matrix_operations(const int16_t *A, const int16_t *B, int32_t *SW_Sum, int32_t *SW_Diff, int32_t *SW_Result)
+//Timed runs of each path per input, the cycle counts printed are averages over them
+#ifndef BENCH_RUNS
+#define BENCH_RUNS 100
+#endif
+
+//Original three-pass version (sum loop, diff loop, i-j-k product loop), kept as the reference the
+//benchmark suite checks every path against, and to show what the fused kernel below gains
+void software_matrix_operations_naive(const int16_t *A, const int16_t *B, int32_t *SW_Sum, int32_t *SW_Diff, int32_t *SW_Result)
 {//const is added to pointer parameters to indicate that the function does not modify the data pointed to by A and B
     //thus, it's sure that A and B are not changed inside this function
     int i, j, k;
     
     // Compute element-wise addition: SW_Sum = A + B
-    for (i = 0; i < 16; i++)
+    for (i = 0; i < ACCEL_NN; i++)
     {
         SW_Sum[i] = (int32_t)A[i] + (int32_t)B[i];  // Cast to 32-bit for safe addition
     }
     
     // Compute element-wise subtraction: SW_Diff = A - B
-    for (i = 0; i < 16; i++)
+    for (i = 0; i < ACCEL_NN; i++)
     {
         SW_Diff[i] = (int32_t)A[i] - (int32_t)B[i];  // Cast to 32-bit for safe subtraction
     }
     
     // Compute matrix multiplication: SW_Result = A * B
-    for (i=0; i<4; i++)  //i goes from 0 to 3
+    for (i=0; i<ACCEL_N; i++)  //i goes from 0 to 3
     {
-        for (j=0; j<4; j++)  //j goes from 0 to 3
+        for (j=0; j<ACCEL_N; j++)  //j goes from 0 to 3
         {
             int32_t sum = 0;  // Changed to int32_t (result fits in 32 bits for safe range)
-            for (k= 0; k<4; k++)  //k goes from 0 to 3
+            for (k= 0; k<ACCEL_N; k++)  //k goes from 0 to 3
             {
-                sum = sum + (int32_t)A[i*4 + k] * (int32_t)B[k*4 + j];  // Cast to 32-bit for multiplication
+                sum = sum + (int32_t)A[i*ACCEL_N + k] * (int32_t)B[k*ACCEL_N + j];  // Cast to 32-bit for multiplication
   //A[index] is equivalent to *(A + index), so there is no need to use *(&A + index).
   //thus normal array indexing instead of manual pointer arithmetic is used
  // A[i*4 + k] accesses the element at row i, column k in a flat (1D) array representation of a 2D matrix
@@ -57,20 +74,87 @@ void software_matrix_operations(const int16_t *A, const int16_t *B, int32_t *SW_
        //above, the value of k changes from 0 to 3, so that all rows of any particular column j of matrix B are accessed
             }//end of k loop, the calcln/sum for one element SW_Result[i][j] of one row, is complete, k would now reset to 0 for next column (j++) value
             
-            SW_Result[i*4 + j] = sum;  //this calculation/sum is stored in SW_Result at this particular index of SW_Result[i][j]
+            SW_Result[i*ACCEL_N + j] = sum;  //this calculation/sum is stored in SW_Result at this particular index of SW_Result[i][j]
         }//end of j loop, j would now reset to 0 for next row (i++), one complete row of SW_Result is calculated
     
     }//end of i loop, that means all rows have been processed, thus matrix multiplication is complete
 }
 
-void hardware_matrix_operations(const int16_t *A, const int16_t *B, 
-                                 int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
+//Software kernel used as the baseline and as the CPU fallback: one pass, sum/diff/product of a row together
+//For ACCEL_N = 4 it is fully unrolled: the 16 B elements are loaded into registers once, then every A row is
+//loaded once and gives its 4 sums, 4 diffs and 4 products (no loop counters, no strided reloads of B columns)
+//Other sizes use the same single pass with i-k-j order, so B is read row-wise (unit stride)
+void software_matrix_operations(const int16_t *A, const int16_t *B, int32_t *SW_Sum, int32_t *SW_Diff, int32_t *SW_Result)
+{
+#if ACCEL_N == 4
+    const int32_t b00 = B[0], b01 = B[1], b02 = B[2], b03 = B[3];
+    const int32_t b10 = B[4], b11 = B[5], b12 = B[6], b13 = B[7];
+    const int32_t b20 = B[8], b21 = B[9], b22 = B[10], b23 = B[11];
+    const int32_t b30 = B[12], b31 = B[13], b32 = B[14], b33 = B[15];
+
+//row r of all three results (r is a constant, so every index below is a fixed offset)
+#define SW_ROW4(r)                                                                        \
+    do                                                                                    \
+    {                                                                                     \
+        const int32_t a0 = A[4*(r)], a1 = A[4*(r) + 1], a2 = A[4*(r) + 2], a3 = A[4*(r) + 3]; \
+        SW_Sum[4*(r)] = a0 + b##r##0;                                                     \
+        SW_Sum[4*(r) + 1] = a1 + b##r##1;                                                 \
+        SW_Sum[4*(r) + 2] = a2 + b##r##2;                                                 \
+        SW_Sum[4*(r) + 3] = a3 + b##r##3;                                                 \
+        SW_Diff[4*(r)] = a0 - b##r##0;                                                    \
+        SW_Diff[4*(r) + 1] = a1 - b##r##1;                                                \
+        SW_Diff[4*(r) + 2] = a2 - b##r##2;                                                \
+        SW_Diff[4*(r) + 3] = a3 - b##r##3;                                                \
+        SW_Result[4*(r)] = a0*b00 + a1*b10 + a2*b20 + a3*b30;                             \
+        SW_Result[4*(r) + 1] = a0*b01 + a1*b11 + a2*b21 + a3*b31;                         \
+        SW_Result[4*(r) + 2] = a0*b02 + a1*b12 + a2*b22 + a3*b32;                         \
+        SW_Result[4*(r) + 3] = a0*b03 + a1*b13 + a2*b23 + a3*b33;                         \
+    } while (0)
+
+    SW_ROW4(0);
+    SW_ROW4(1);
+    SW_ROW4(2);
+    SW_ROW4(3);
+#undef SW_ROW4
+#else
+    int i, j, k;
+
+    for (i = 0; i < ACCEL_N; i++)
+    {
+        const int16_t *a = A + i*ACCEL_N;
+        int32_t acc[ACCEL_N];
+
+        for (j = 0; j < ACCEL_N; j++)
+        {
+            SW_Sum[i*ACCEL_N + j] = (int32_t)a[j] + (int32_t)B[i*ACCEL_N + j];
+            SW_Diff[i*ACCEL_N + j] = (int32_t)a[j] - (int32_t)B[i*ACCEL_N + j];
+            acc[j] = 0;
+        }
+        for (k = 0; k < ACCEL_N; k++)
+        {
+            const int32_t aik = a[k];
+            const int16_t *b = B + k*ACCEL_N;  //row k of B, unit stride
+
+            for (j = 0; j < ACCEL_N; j++)
+            {
+                acc[j] += aik * (int32_t)b[j];
+            }
+        }
+        for (j = 0; j < ACCEL_N; j++)
+        {
+            SW_Result[i*ACCEL_N + j] = acc[j];
+        }
+    }
+#endif
+}
+
+//Loads A and B one element per write (32 writes), the original load path
+void hw_load_ab(volatile uint32_t *accel_base, const int16_t *A, const int16_t *B)
 {
-    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;  //Pointer to hardware accelerator base address
     int i;
 
-    //Step 1: Writing matrix A to addresses 0..15 (hardware takes lower 16 bits)
-    for (i = 0; i < 16; i++)
+    //Writing matrix A to addresses 0..15 (hardware takes lower 16 bits)
+    for (i = 0; i < ACCEL_NN; i++)
     {
         accel_base[A_OFFSET + i] = (uint32_t)A[i];  //Cast to 32-bit, hardware extracts [15:0], because avalon MM bus is 32 bit wide
                                          //But, again the hardware only uses the lower 16 bits for 16-bit inputs
@@ -78,149 +162,1779 @@ void hardware_matrix_operations(const int16_t *A, const int16_t *B,
         //A_OFFSET is the base offset for matrix A in the hardware
     }
     
-    //Step 2: Writing matrix B to addresses 16..31 (hardware takes lower 16 bits)
-    for (i = 0; i < 16; i++)
+    //Writing matrix B to addresses 16..31 (hardware takes lower 16 bits)
+    for (i = 0; i < ACCEL_NN; i++)
     {
         accel_base[B_OFFSET + i] = (uint32_t)B[i];  //same.........
     }
-    
+}
+
+//Writing matrix A to addresses 96..103, two elements per word
+static void hw_load_a_packed(volatile uint32_t *accel_base, const int16_t *A)
+{
+    int w;
+
+    for (w = 0; w < ACCEL_NN / 2; w++)
+    {
+        accel_base[A_PACKED_OFFSET + w] = pack_int16_pair(A, w);
+    }
+}
+
+//Writing matrix B to addresses 104..111, two elements per word
+static void hw_load_b_packed(volatile uint32_t *accel_base, const int16_t *B)
+{
+    int w;
+
+    for (w = 0; w < ACCEL_NN / 2; w++)
+    {
+        accel_base[B_PACKED_OFFSET + w] = pack_int16_pair(B, w);
+    }
+}
+
+//Loads A and B two elements per write through the packed windows (16 writes instead of 32 for N = 4)
+void hw_load_ab_packed(volatile uint32_t *accel_base, const int16_t *A, const int16_t *B)
+{
+    hw_load_a_packed(accel_base, A);
+    hw_load_b_packed(accel_base, B);
+}
+
+//Loads int8 A and B four elements per write (4 + 4 writes for N = 4), the accelerator must be in INT8 mode
+void hw_load_ab_int8(volatile uint32_t *accel_base, const int8_t *A, const int8_t *B)
+{
+    int w;
+
+    for (w = 0; w < ACCEL_NN / 4; w++)
+    {
+        accel_base[A_PACKED_OFFSET + w] = pack_int8_quad(A, w);
+    }
+    for (w = 0; w < ACCEL_NN / 4; w++)
+    {
+        accel_base[B_PACKED_OFFSET + w] = pack_int8_quad(B, w);
+    }
+}
+
+//Steps 3 to 5: writes CONTROL (START and the given bits), polls DONE and reads back the selected results
+//returns the STATUS value that showed DONE (PROD_OVF is valid in it)
+static uint32_t hw_run_and_read(volatile uint32_t *accel_base, uint32_t control, uint32_t ops,
+                                int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
+{
+    uint32_t status;
+    int i;
+
     //Step 3: Writing 1 to CONTROL register to start computation
-    accel_base[CONTROL_OFFSET] = 1;  //1 written to the LSB of CONTROL register to start operation
+    accel_base[CONTROL_OFFSET] = CONTROL_START | control | CONTROL_OPS(ops);  //1 written to the LSB of CONTROL register to start operation
     
     //Step 4: Poll STATUS register until DONE=1 and BUSY=0
-    while ((accel_base[STATUS_OFFSET] & 0x1) == 0)  //STATUS_OFFSET is at address 81, wait for DONE bit
+    do  //STATUS_OFFSET is at address 81, wait for DONE bit
     {               //when we look for status register to be 'd1, busy bit must be 0 and done bit must be 1
-        // Wait for DONE bit to be set  
-    }
+        status = accel_base[STATUS_OFFSET];  // Wait for DONE bit to be set  
+    } while ((status & STATUS_DONE) == 0);
     
-    // Step 5: Read results from hardware (all 32-bit signed outputs)
+    // Step 5: Read the selected results from hardware (all 32-bit signed outputs)
     // Read SUM matrix (addresses 32..47)
-    for (i = 0; i < 16; i++)
+    if (ops & OP_ADD)
     {
-        HW_Sum[i] = (int32_t)accel_base[SUM_OFFSET + i];  //Casted to signed 32-bit
-        //because without 32-bit cast, the values would be interpreted as unsigned,
-        //and thus, negative values might be misinterpreted as large positive values, cast was used to avoid this issue
+        for (i = 0; i < ACCEL_NN; i++)
+        {
+            HW_Sum[i] = (int32_t)accel_base[SUM_OFFSET + i];  //Casted to signed 32-bit
+            //because without 32-bit cast, the values would be interpreted as unsigned,
+            //and thus, negative values might be misinterpreted as large positive values, cast was used to avoid this issue
+        }
     }
     
     // Read DIFF matrix (addresses 48..63)
-    for (i = 0; i < 16; i++)
+    if (ops & OP_SUB)
     {
-        HW_Diff[i] = (int32_t)accel_base[DIFF_OFFSET + i];  //Casted to signed 32-bit
+        for (i = 0; i < ACCEL_NN; i++)
+        {
+            HW_Diff[i] = (int32_t)accel_base[DIFF_OFFSET + i];  //Casted to signed 32-bit
+        }
     }
     
     // Read PROD matrix (addresses 64..79) - 32-bit signed values
-    for (i = 0; i < 16; i++)
+    if (ops & OP_MUL)
     {
-        HW_Prod[i] = (int32_t)accel_base[PROD_OFFSET + i];  // Cast to signed 32-bit
+        for (i = 0; i < ACCEL_NN; i++)
+        {
+            HW_Prod[i] = (int32_t)accel_base[PROD_OFFSET + i];  // Cast to signed 32-bit
+        }
     }
+    return status;
 }
 
+//Same as hardware_matrix_operations(), but only computes and reads back the operations in ops (OP_* bits)
+//the result pointers of operations that are not selected are not touched and may be NULL
+//e.g. ops = OP_MUL reads 16 words instead of 48 and skips the SUM/DIFF work in the accelerator
+void hardware_matrix_operations_ops(const int16_t *A, const int16_t *B, uint32_t ops,
+                                    int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;  //Pointer to hardware accelerator base address
 
-int main() 
+    ops &= OP_ALL;
+    if (ops == 0)
+    {
+        return;  //nothing selected (0 would mean "all" to the hardware)
+    }
+
+    //Step 1 and 2: Writing matrices A and B through the packed windows
+    //this halves the load traffic compared to hw_load_ab(), which writes one element per word
+    hw_load_ab_packed(accel_base, A, B);
+
+    hw_run_and_read(accel_base, 0, ops, HW_Sum, HW_Diff, HW_Prod);
+}
+
+void hardware_matrix_operations(const int16_t *A, const int16_t *B, 
+                                 int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
 {
-    int16_t A[4][4];   //16-bit signed to match hardware input
-    int16_t B[4][4];   //16-bit signed to match hardware input
-    int32_t SW_Prod[4][4];  //32-bit signed (result fits in 32 bits for safe range)
-    int32_t SW_Sum[4][4];   //32-bit signed (same as above.....)
-    int32_t SW_Diff[4][4];  //32-bit signed
+    hardware_matrix_operations_ops(A, B, OP_ALL, HW_Sum, HW_Diff, HW_Prod);
+}
 
-    int32_t HW_Sum[16];   //32-bit signed to match hardware output
-    int32_t HW_Diff[16];  //32-bit signed to match hardware output
-    int32_t HW_Prod[16];  //32-bit signed to match hardware output
+//hardware_matrix_operations() with the result cache in front (matrix_result_cache.h): a pair seen recently
+//is answered from the table without touching the bus, a new one runs on the accelerator and is stored
+//returns 1 for a cache hit, 0 if the accelerator computed it
+int hardware_matrix_operations_cached(const int16_t *A, const int16_t *B,
+                                      int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
+{
+    uint32_t hash = result_cache_hash(A, B);
 
-    uint32_t sw_cycles, hw_cycles;
-    int i, j;  //i and j are normal integer loop counters, so %d format specifier is used in printf and scanf
-             //unlike, int16_t uses %hd, int32_t uses %d format specifiers
-    char cont; //to store user choice to continue or not(Y/N)
-    
-    
-    while (1) 
+    if (result_cache_lookup(hash, A, B, HW_Sum, HW_Diff, HW_Prod))
     {
-        printf("\n");  
-        //to take input elements of matrix A from user and print prompts accordingly
-        printf("Enter Matrix A (4x4) - 16-bit signed (safe range: -%d to %d):\n", 
-               SAFE_INPUT_MAX, SAFE_INPUT_MAX);
-        for (i = 0; i < 4; i++) 
+        return 1;
+    }
+    hardware_matrix_operations(A, B, HW_Sum, HW_Diff, HW_Prod);
+    result_cache_insert(hash, A, B, HW_Sum, HW_Diff, HW_Prod);
+    return 0;
+}
+
+//Same as hardware_matrix_operations_ops() for column-major operands: trans = CONTROL_TRANS_A and/or
+//CONTROL_TRANS_B, the accelerator reads the flagged matrices transposed, so they are written as they are
+//(no transposing copy); SUM/DIFF are of the transposed operands too
+void hardware_matrix_operations_trans(const int16_t *A, const int16_t *B, uint32_t ops, uint32_t trans,
+                                      int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    ops &= OP_ALL;
+    if (ops == 0)
+    {
+        return;
+    }
+
+    hw_load_ab_packed(accel_base, A, B);
+    hw_run_and_read(accel_base, trans & (CONTROL_TRANS_A | CONTROL_TRANS_B), ops, HW_Sum, HW_Diff, HW_Prod);
+}
+
+//Path per call: HW_PATH_MMIO goes through the accelerator's slave (hardware_matrix_operations_ops()),
+//HW_PATH_CI computes PROD with the custom instruction and SUM/DIFF on the CPU, no bus access at all
+//(worth it for single small jobs, where the loads/stores through the interconnect dominate);
+//without MATRIX_CI_BASE the custom instruction is not in the system and HW_PATH_CI uses the slave as well
+#define HW_PATH_MMIO 0
+#define HW_PATH_CI 1
+
+void hardware_matrix_operations_path(const int16_t *A, const int16_t *B, uint32_t ops,
+                                     int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod, int path)
+{
+#ifdef MATRIX_CI_BASE
+    int i;
+
+    if (path == HW_PATH_CI)
+    {
+        for (i = 0; i < ACCEL_NN; i++)
         {
-            for (j = 0; j < 4; j++) 
+            if (ops & OP_ADD)
             {
-                printf("A[%d][%d] = ", i, j);
-                scanf("%hd", &A[i][j]);  // Changed to %hd for int16_t
+                HW_Sum[i] = (int32_t)A[i] + (int32_t)B[i];
+            }
+            if (ops & OP_SUB)
+            {
+                HW_Diff[i] = (int32_t)A[i] - (int32_t)B[i];
             }
         }
-        
-        //to take input elements of matrix B from user and print prompts accordingly
-        printf("\nEnter Matrix B (4x4) - 16-bit signed (safe range: -%d to %d):\n", 
-               SAFE_INPUT_MAX, SAFE_INPUT_MAX);
-        for (i = 0; i < 4; i++) 
+        if (ops & OP_MUL)
+        {
+            matrix_ci_mul(A, B, HW_Prod, 0);
+        }
+        return;
+    }
+#else
+    (void)path;
+#endif
+    hardware_matrix_operations_ops(A, B, ops, HW_Sum, HW_Diff, HW_Prod);
+}
+
+//Full-range version: the same as hardware_matrix_operations(), but PROD as 64-bit values, so A and B can use
+//the whole int16 range (no SAFE_INPUT_MAX); PROD_HI is only read for the elements flagged in PROD_OVF_MASK,
+//and only when STATUS.PROD_OVF is set, so results that fit in 32 bits cost no extra bus reads (SAT_PROD must be off)
+void hardware_matrix_operations_wide(const int16_t *A, const int16_t *B,
+                                     int32_t *HW_Sum, int32_t *HW_Diff, int64_t *HW_Prod)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    int32_t lo[ACCEL_NN];
+    uint32_t status;
+    int i, w, b;
+
+    hw_load_ab_packed(accel_base, A, B);
+    status = hw_run_and_read(accel_base, 0, OP_ALL, HW_Sum, HW_Diff, lo);
+
+    for (i = 0; i < ACCEL_NN; i++)
+    {
+        HW_Prod[i] = lo[i];  //sign-extended, the common case
+    }
+
+    if (status & STATUS_PROD_OVF)
+    {
+        for (w = 0; w < PROD_OVF_WORDS; w++)
         {
-            for (j = 0; j < 4; j++) 
+            uint32_t mask = accel_base[PROD_OVF_OFFSET + w];
+
+            for (b = 0; b < 32 && mask != 0; b++, mask >>= 1)
             {
-                printf("B[%d][%d] = ", i, j);
-                scanf("%hd", &B[i][j]);  //Changed to %hd for int16_t
+                if (mask & 1)
+                {
+                    i = 32 * w + b;
+                    //upper word from PROD_HI, lower word as unsigned, no sign extension of it
+                    HW_Prod[i] = (int64_t)(((uint64_t)accel_base[PROD_HI_OFFSET + i] << 32) | (uint32_t)lo[i]);
+                }
             }
         }
+    }
+}
 
-        // Print input matrices A and B
-        printf("\n_________INPUT MATRICES__________\n");
-        printf("\nMatrix A:\n");
-        for (i = 0; i < 4; i++) 
+//Quantized version: int8 A and B (ACCEL_NN each), after hw_set_precision(1, ...)
+//half the load writes of hardware_matrix_operations_ops() and PROD in ACCEL_N/2 MAC cycles
+void hardware_matrix_operations_int8(const int8_t *A, const int8_t *B, uint32_t ops,
+                                     int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    ops &= OP_ALL;
+    if (ops == 0)
+    {
+        return;
+    }
+
+    hw_load_ab_int8(accel_base, A, B);
+    hw_run_and_read(accel_base, 0, ops, HW_Sum, HW_Diff, HW_Prod);
+}
+
+//Operand reuse, for one B (e.g. a weight matrix) against many A:
+//hw_load_b() loads B once (8 packed writes for N = 4), then every hw_load_a_and_run() only writes A
+//and starts with REUSE_B, so a job costs 8 load writes instead of 16 (32 with hw_load_ab())
+void hw_load_b(const int16_t *B)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    hw_load_b_packed(accel_base, B);
+}
+
+//Same as hardware_matrix_operations_ops(), with the B of the last hw_load_b()
+void hw_load_a_and_run_ops(const int16_t *A, uint32_t ops, int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    ops &= OP_ALL;
+    if (ops == 0)
+    {
+        return;
+    }
+
+    hw_load_a_packed(accel_base, A);
+    hw_run_and_read(accel_base, CONTROL_REUSE_B, ops, HW_Sum, HW_Diff, HW_Prod);
+}
+
+void hw_load_a_and_run(const int16_t *A, int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
+{
+    hw_load_a_and_run_ops(A, OP_ALL, HW_Sum, HW_Diff, HW_Prod);
+}
+
+
+//Programs the DMA registers for a batch of count pairs that writes out_blocks result blocks to out
+//(count blocks normally, 1 for an accumulating batch), the caller then writes CONTROL with START | DMA
+//B = NULL for a REUSE_B batch, which does not read B from memory
+static void hw_dma_setup(volatile uint32_t *accel_base, const int16_t *A, const int16_t *B, int32_t *out,
+                         uint32_t count, uint32_t out_blocks)
+{
+    //Write back the operands from the data cache and drop any cached lines of the result blocks,
+    //the accelerator reads/writes memory directly (no-op on a Nios II without data cache)
+    alt_dcache_flush((void *)A, count * ACCEL_NN * sizeof(int16_t));
+    alt_dcache_flush(out, out_blocks * DMA_RESULT_WORDS * sizeof(int32_t));
+
+    accel_base[DMA_SRC_A_OFFSET] = (uint32_t)(uintptr_t)A;
+    if (B != NULL)
+    {
+        alt_dcache_flush((void *)B, count * ACCEL_NN * sizeof(int16_t));
+        accel_base[DMA_SRC_B_OFFSET] = (uint32_t)(uintptr_t)B;
+    }
+    accel_base[DMA_DST_OFFSET] = (uint32_t)(uintptr_t)out;
+    accel_base[BATCH_COUNT_OFFSET] = count;
+}
+
+//Polls STATUS until DONE; in DMA mode DONE is only set after the last result block is in memory
+static void hw_wait_done(volatile uint32_t *accel_base)
+{
+    while ((accel_base[STATUS_OFFSET] & STATUS_DONE) == 0)
+    {
+        // Wait for DONE bit to be set
+    }
+}
+
+//Batch version over the DMA master: n matrix pairs, one START (and one DONE poll) per up to BATCH_MAX pairs
+//A and B hold n consecutive row-major ACCEL_N x ACCEL_N matrices (16 int16 each for N = 4), 4-byte aligned
+//out receives n consecutive result blocks of DMA_RESULT_WORDS words: SUM in [0..15], DIFF in [16..31], PROD in [32..47]
+//(for N = 4; in general SUM, DIFF and PROD are ACCEL_NN words each)
+//The buffers must be in memory that the accelerator's DMA master is connected to in Platform Designer,
+//at the same addresses the CPU sees
+//with ops (OP_* bits), only the selected parts of each result block are computed and written,
+//the other parts of out are left untouched
+void hw_matrix_batch_ops(const int16_t *A, const int16_t *B, int32_t *out, size_t n, uint32_t ops)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    ops &= OP_ALL;
+    if (ops == 0)
+    {
+        return;
+    }
+
+    while (n > 0)
+    {
+        uint32_t count = (n > BATCH_MAX) ? BATCH_MAX : (uint32_t)n;
+
+        hw_dma_setup(accel_base, A, B, out, count, count);
+        accel_base[CONTROL_OFFSET] = CONTROL_START | CONTROL_DMA | CONTROL_OPS(ops);
+        hw_wait_done(accel_base);
+
+        A += count * ACCEL_NN;
+        B += count * ACCEL_NN;
+        out += count * DMA_RESULT_WORDS;
+        n -= count;
+    }
+}
+
+void hw_matrix_batch(const int16_t *A, const int16_t *B, int32_t *out, size_t n)
+{
+    hw_matrix_batch_ops(A, B, out, n, OP_ALL);
+}
+
+//Batch of n A matrices against the B already in the accelerator (loaded with hw_load_b()), so a caller can
+//load B once for several batches; A and out as for hw_matrix_batch_ops()
+void hw_matrix_batch_loaded_b(const int16_t *A, int32_t *out, size_t n, uint32_t ops)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    ops &= OP_ALL;
+    if (ops == 0 || n == 0)
+    {
+        return;
+    }
+
+    while (n > 0)
+    {
+        uint32_t count = (n > BATCH_MAX) ? BATCH_MAX : (uint32_t)n;
+
+        hw_dma_setup(accel_base, A, NULL, out, count, count);
+        accel_base[CONTROL_OFFSET] = CONTROL_START | CONTROL_DMA | CONTROL_OPS(ops) | CONTROL_REUSE_B;
+        hw_wait_done(accel_base);
+
+        A += count * ACCEL_NN;
+        out += count * DMA_RESULT_WORDS;
+        n -= count;
+    }
+}
+
+//Batch of n A matrices against one B: B (a single matrix) is loaded once through the packed window,
+//then hw_matrix_batch_loaded_b() runs the batch with REUSE_B, so the DMA master reads 8 words per pair instead of 16 (for N = 4)
+//A and out as for hw_matrix_batch_ops()
+void hw_matrix_batch_reuse_b(const int16_t *A, const int16_t *B, int32_t *out, size_t n, uint32_t ops)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    if ((ops & OP_ALL) == 0 || n == 0)
+    {
+        return;
+    }
+
+    hw_load_b_packed(accel_base, B);
+    hw_matrix_batch_loaded_b(A, out, n, ops);
+}
+
+//DMA version for a single pair: the accelerator reads A and B from memory and writes SUM/DIFF/PROD back by itself,
+//so the CPU only writes the address registers and CONTROL, instead of 16 packed words in and 48 words out
+//HW_Out must hold DMA_RESULT_WORDS words, same layout and buffer rules as hw_matrix_batch()
+void hardware_matrix_operations_dma(const int16_t *A, const int16_t *B, int32_t *HW_Out)
+{
+    hw_matrix_batch(A, B, HW_Out, 1);
+}
+
+//Multiple instances: a batch is cut into chunks of MULTI_CHUNK pairs, and every chunk runs as a DMA batch
+//on one of the MATRIX_ACCEL_COUNT instances, so the copies compute in parallel and each writes its part of out
+//SCHED_ROUND_ROBIN: chunk c goes to instance c % MATRIX_ACCEL_COUNT (waits for that one if it is still busy)
+//SCHED_LEAST_BUSY: every chunk goes to the first instance that is idle according to its STATUS,
+//so a slower instance (e.g. one also used by other code) simply gets fewer chunks
+#define SCHED_ROUND_ROBIN 0
+#define SCHED_LEAST_BUSY 1
+
+#ifndef MULTI_CHUNK
+#define MULTI_CHUNK 256  //pairs per chunk: smaller balances better, larger costs fewer STARTs
+#endif
+
+static const uint32_t accel_base_list[MATRIX_ACCEL_COUNT] = { MATRIX_ACCEL_BASE_LIST };
+static uint32_t accel_chunks_done[MATRIX_ACCEL_COUNT];  //chunks finished per instance, for the statistics
+
+//Same arguments and result layout as hw_matrix_batch_ops(), with the pairs spread over all instances
+void hw_multi_batch_ops(const int16_t *A, const int16_t *B, int32_t *out, size_t n, uint32_t ops, int policy)
+{
+    int inflight[MATRIX_ACCEL_COUNT] = {0};  //a chunk was started on this instance and is not done yet
+    int running = 0;
+    int next = 0;  //round-robin: instance for the next chunk
+    int i;
+
+    ops &= OP_ALL;
+    if (ops == 0)
+    {
+        return;
+    }
+
+    while (n > 0 || running > 0)
+    {
+        int target = -1;
+
+        //Collect the instances whose chunk is finished (DONE is cleared by the START, so it belongs to this chunk)
+        for (i = 0; i < MATRIX_ACCEL_COUNT; i++)
         {
-            for (j = 0; j < 4; j++) 
+            volatile uint32_t *accel_base = (uint32_t *)(uintptr_t)accel_base_list[i];
+
+            if (inflight[i] && (accel_base[STATUS_OFFSET] & STATUS_DONE))
             {
-                printf("%d ", A[i][j]);
+                inflight[i] = 0;
+                running--;
+                accel_chunks_done[i]++;
             }
-            printf("\n");
         }
-        
-        printf("\nMatrix B:\n");
-        for (i = 0; i < 4; i++) 
+
+        if (n == 0)
+        {
+            continue;  //everything dispatched, wait for the rest
+        }
+
+        if (policy == SCHED_ROUND_ROBIN)
         {
-            for (j = 0; j < 4; j++) 
+            if (!inflight[next])
             {
-                printf("%d ", B[i][j]);
+                target = next;
+            }
+        } else
+        {
+            for (i = 0; i < MATRIX_ACCEL_COUNT; i++)
+            {
+                if (!inflight[i])
+                {
+                    target = i;
+                    break;
+                }
             }
-            printf("\n");
         }
 
-        // Setup NIOS II timer pointer
-        volatile uint32_t *timer = (uint32_t *)TIMER_BASE;
-        uint32_t last_count;
-        
-        // SOFTWARE: Matrix operations with timing
-        *(timer + 2) = 0xFFFF;       //Set timer period low (16-bit)
-        *(timer + 3) = 0xFFFF;       //Set timer period high (16-bit) 
-        *(timer + 1) = 0x4;       //Start timer (control bit[2]=1)
-        
-        software_matrix_operations((int16_t *)A, (int16_t *)B, (int32_t *)SW_Sum, (int32_t *)SW_Diff, (int32_t *)SW_Prod);
-        
-        *(timer + 1) = 0x8;          //Stop timer (control bit[3]=1)
-        *(timer + 4) = 1;          //Snapshot counter
-        last_count = (*(timer + 5) << 16) | *(timer + 4); // Read 32-bit count (high and low)
-        sw_cycles = 0xFFFFFFFF - last_count;             // Calculate cycles
+        if (target >= 0)
+        {
+            volatile uint32_t *accel_base = (uint32_t *)(uintptr_t)accel_base_list[target];
+            uint32_t count = (n > MULTI_CHUNK) ? MULTI_CHUNK : (uint32_t)n;
+
+            hw_dma_setup(accel_base, A, B, out, count, count);
+            accel_base[CONTROL_OFFSET] = CONTROL_START | CONTROL_DMA | CONTROL_OPS(ops);
+            inflight[target] = 1;
+            running++;
+            next = (target + 1) % MATRIX_ACCEL_COUNT;
+
+            A += count * ACCEL_NN;
+            B += count * ACCEL_NN;
+            out += count * DMA_RESULT_WORDS;
+            n -= count;
+        }
+    }
+}
 
+void hw_multi_batch(const int16_t *A, const int16_t *B, int32_t *out, size_t n)
+{
+    hw_multi_batch_ops(A, B, out, n, OP_ALL, SCHED_LEAST_BUSY);
+}
 
+//Prints how many chunks every instance has finished since reset, to check the load balance
+void hw_multi_print_stats(void)
+{
+    int i;
 
-        // HARDWARE: Matrix operations with timing
-        *(timer + 2) = 0xFFFF;       //Set timer period low
-        *(timer + 3) = 0xFFFF;    //Set timer period high
-        *(timer + 1) = 0x4;       //Start timer
-        
-        hardware_matrix_operations((int16_t *)A, (int16_t *)B, HW_Sum, HW_Diff, HW_Prod);
-        
-        *(timer + 1) = 0x8;   //Stop timer
-        *(timer + 4) = 1;      //Snapshot counter
-        last_count = (*(timer + 5) << 16) | *(timer + 4); // Read 32-bit count
-        hw_cycles = 0xFFFFFFFF - last_count;             // Calculate cycles
+    for (i = 0; i < MATRIX_ACCEL_COUNT; i++)
+    {
+        printf("matrix_%d at 0x%08" PRIx32 ": %" PRIu32 " chunks\n", i, accel_base_list[i], accel_chunks_done[i]);
+    }
+}
+
+//Reads the DMA_RESULT_WORDS (48 for N = 4) result words of the current host bank into out: SUM in [0..15], DIFF in [16..31], PROD in [32..47]
+//the SUM, DIFF and PROD windows are consecutive (32..79 for N = 4), so this is a single pass over the bus
+static void hw_read_results(volatile uint32_t *accel_base, int32_t *out)
+{
+    int i;
+
+    for (i = 0; i < DMA_RESULT_WORDS; i++)
+    {
+        out[i] = (int32_t)accel_base[SUM_OFFSET + i];  //Casted to signed 32-bit
+    }
+}
+
+//Double-buffered version for n pairs over the slave windows, results in the same 48-word block layout
+//as hw_matrix_batch(); while pair j computes in bank j%2, pair j-1 is read back from and pair j+1 is
+//loaded into the other bank, so the bus transfers overlap the computation
+void hw_matrix_pingpong(const int16_t *A, const int16_t *B, int32_t *out, size_t n)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    size_t j;
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    accel_base[CONTROL_OFFSET] = CONTROL_HOST_BANK(0);  //no START, only points the windows at bank 0
+    hw_load_ab_packed(accel_base, A, B);
+
+    for (j = 0; j < n; j++)
+    {
+        uint32_t bank = (uint32_t)(j & 1);
+
+        //Pair j starts in 'bank', the windows swap to the other bank in the same write
+        //(if pair j-1 is still running, the hardware holds this START until it is done)
+        accel_base[CONTROL_OFFSET] = CONTROL_START | CONTROL_RUN_BANK(bank) | CONTROL_HOST_BANK(bank ^ 1);
+
+        if (j > 0)
+        {
+            //Pair j-1 ran in the other bank: wait for it, then read its results
+            //this also makes sure nothing is still reading that bank's operands before they are overwritten
+            while ((accel_base[STATUS_OFFSET] & STATUS_DONE_BANK(bank ^ 1)) == 0)
+            {
+                // Wait for the other bank's DONE bit
+            }
+            hw_read_results(accel_base, out + (j - 1) * DMA_RESULT_WORDS);
+        }
+
+        if (j + 1 < n)
+        {
+            hw_load_ab_packed(accel_base, A + (j + 1) * ACCEL_NN, B + (j + 1) * ACCEL_NN);
+        }
+    }
+
+    //Last pair: read its results from its own bank, then leave the windows on bank 0 for the other functions
+    j = n - 1;
+    accel_base[CONTROL_OFFSET] = CONTROL_HOST_BANK(j & 1);
+    while ((accel_base[STATUS_OFFSET] & STATUS_DONE_BANK(j & 1)) == 0)
+    {
+        // Wait for the last job's DONE bit
+    }
+    hw_read_results(accel_base, out + j * DMA_RESULT_WORDS);
+    accel_base[CONTROL_OFFSET] = CONTROL_HOST_BANK(0);
+}
+
+//Job queue: pushes one pair into the accelerator's input queue (8 packed A words, then 8 packed B words
+//for N = 4, the last write commits the entry), returns -1 without writing if the queue is full
+int hw_jobq_push(const int16_t *A, const int16_t *B)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    int w;
+
+    if (STATUS_JOBQ_IN(accel_base[STATUS_OFFSET]) >= accel_base[JOBQ_OFFSET])
+    {
+        return -1;
+    }
+
+    for (w = 0; w < ACCEL_NN / 2; w++)
+    {
+        accel_base[JOBQ_IN_OFFSET + w] = pack_int16_pair(A, w);
+    }
+    for (w = 0; w < ACCEL_NN / 2; w++)
+    {
+        accel_base[JOBQ_IN_OFFSET + ACCEL_NN / 2 + w] = pack_int16_pair(B, w);
+    }
+    return 0;
+}
+
+//Job queue: reads the oldest finished result set (DMA_RESULT_WORDS words, same block layout as
+//hw_matrix_batch()) and pops it, returns -1 if no result is ready yet
+int hw_jobq_pop(int32_t *out)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    int i;
+
+    if (STATUS_JOBQ_OUT(accel_base[STATUS_OFFSET]) == 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < DMA_RESULT_WORDS; i++)
+    {
+        out[i] = (int32_t)accel_base[JOBQ_OUT_OFFSET + i];  //Casted to signed 32-bit
+    }
+    accel_base[JOBQ_OFFSET] = JOBQ_POP;
+    return 0;
+}
+
+//n pairs through the job queues, same buffers and result layout as hw_matrix_pingpong() (no DMA needed):
+//keeps the input queue topped up and pops results as they come, so several jobs are in flight
+//and the accelerator runs them back to back while the CPU is moving the next operands
+void hw_matrix_queue(const int16_t *A, const int16_t *B, int32_t *out, size_t n)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    size_t pushed = 0;
+    size_t popped = 0;
+
+    accel_base[JOBQ_OFFSET] = JOBQ_FLUSH;  //start from empty queues
+
+    while (popped < n)
+    {
+        while (pushed < n && hw_jobq_push(A + pushed * ACCEL_NN, B + pushed * ACCEL_NN) == 0)
+        {
+            pushed++;
+        }
+        while (popped < pushed && hw_jobq_pop(out + popped * DMA_RESULT_WORDS) == 0)
+        {
+            popped++;
+        }
+    }
+}
+
+//Interrupt-driven (asynchronous) completion
+//hw_async_busy is 1 from hw_matrix_batch_async() until the accelerator's DONE interrupt has been handled
+static volatile int hw_async_busy = 0;
+static void (*hw_async_callback)(void *context) = NULL;
+static void *hw_async_context = NULL;
+
+//ISR for the accelerator interrupt: acknowledges it and runs the callback of the finished batch
+static void hw_matrix_isr(void *isr_context)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    void (*callback)(void *context) = hw_async_callback;
+
+    (void)isr_context;
+    accel_base[IRQ_OFFSET] = IRQ_ENABLE | IRQ_PENDING;  //clear pending, keep the interrupt enabled
+    hw_async_busy = 0;
+    if (callback != NULL)
+    {
+        callback(hw_async_context);  //runs in interrupt context, keep it short
+    }
+}
+
+//Registers the accelerator ISR with the HAL and enables the accelerator's interrupt
+//returns 0 on success, the HAL error code otherwise
+int hw_matrix_async_init(void)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    int ret;
+
+    accel_base[IRQ_OFFSET] = IRQ_PENDING;  //interrupt off and nothing pending while registering
+    ret = alt_ic_isr_register(MATRIX_ACCEL_IRQ_INTERRUPT_CONTROLLER_ID, MATRIX_ACCEL_IRQ,
+                              hw_matrix_isr, NULL, NULL);
+    if (ret == 0)
+    {
+        accel_base[IRQ_OFFSET] = IRQ_ENABLE;
+    }
+    return ret;
+}
+
+//Starts a DMA batch (same buffers and layout as hw_matrix_batch()) and returns right away
+//callback (may be NULL) is called from the ISR once all n result blocks are in memory,
+//hw_matrix_async_busy() can be polled instead; n must be 1..BATCH_MAX
+//returns 0 if the batch was started, -1 if a previous one is still running or n is out of range
+int hw_matrix_batch_async(const int16_t *A, const int16_t *B, int32_t *out, size_t n,
+                          void (*callback)(void *context), void *context)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    if (hw_async_busy || n == 0 || n > BATCH_MAX)
+    {
+        return -1;
+    }
+
+    hw_async_callback = callback;
+    hw_async_context = context;
+    hw_async_busy = 1;
+
+    hw_dma_setup(accel_base, A, B, out, (uint32_t)n, (uint32_t)n);
+    accel_base[CONTROL_OFFSET] = CONTROL_START | CONTROL_DMA;
+    return 0;
+}
+
+//1 while an asynchronous batch is still running
+int hw_matrix_async_busy(void)
+{
+    return hw_async_busy;
+}
+
+//Streaming setup: after hw_stream_enable() the accelerator takes operand packets from its Avalon-ST
+//sink (A then B, packed like the windows, or only A with reuse_b) and sends the ops results out of its
+//source, with no CPU involved; with reuse_b, load B first with hw_load_b() (bank 0)
+void hw_stream_enable(uint32_t ops, int reuse_b)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    uint32_t mode = (accel_base[MODE_OFFSET] & ~MODE_STREAM_MASK) | MODE_STREAM_EN | MODE_STREAM_OPS(ops & OP_ALL);
+
+    if (reuse_b)
+    {
+        mode |= MODE_STREAM_REUSE_B;
+    }
+    accel_base[MODE_OFFSET] = mode;  //the precision bits are kept
+}
+
+//Stops taking new stream packets, a stream job already started still completes
+void hw_stream_disable(void)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    accel_base[MODE_OFFSET] = accel_base[MODE_OFFSET] & ~MODE_STREAM_MASK;
+}
+
+//Precision mode for the following jobs: int8 = 1 switches the packed windows, DMA and the stream sink
+//to int8 operands (use hardware_matrix_operations_int8()), saturate = 1 clamps PROD to the int32 range,
+//so the inputs no longer have to stay within SAFE_INPUT_MAX; the streaming bits are kept
+void hw_set_precision(int int8, int saturate)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    uint32_t mode = accel_base[MODE_OFFSET] & ~MODE_PRECISION_MASK;
+
+    if (int8)
+    {
+        mode |= MODE_INT8;
+    }
+    if (saturate)
+    {
+        mode |= MODE_SAT_PROD;
+    }
+    accel_base[MODE_OFFSET] = mode;
+}
+
+//Zero skip: on = 1 lets the accelerator skip the MAC cycles of all-zero A columns / B rows (MODE_ZERO_SKIP),
+//the other MODE bits are kept
+void hw_set_zero_skip(int on)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    uint32_t mode = accel_base[MODE_OFFSET] & ~MODE_ZERO_SKIP;
+
+    if (on)
+    {
+        mode |= MODE_ZERO_SKIP;
+    }
+    accel_base[MODE_OFFSET] = mode;
+}
+
+//Row-valid mask of an ACCEL_N x ACCEL_N matrix: bit r set if row r has a non-zero element
+static uint32_t hw_nonzero_rows(const int16_t *M)
+{
+    uint32_t mask = 0;
+    int r, c;
+
+    for (r = 0; r < ACCEL_N; r++)
+    {
+        for (c = 0; c < ACCEL_N; c++)
+        {
+            if (M[r*ACCEL_N + c] != 0)
+            {
+                mask |= 1u << r;
+                break;
+            }
+        }
+    }
+    return mask;
+}
+
+//Loads only the non-zero rows of A and B through the packed windows (ACCEL_N/2 words per row),
+//returns the ROW_VALID value for them
+static uint32_t hw_load_ab_sparse(volatile uint32_t *accel_base, const int16_t *A, const int16_t *B)
+{
+    uint32_t rows_a = hw_nonzero_rows(A);
+    uint32_t rows_b = hw_nonzero_rows(B);
+    int r, w;
+
+    for (r = 0; r < ACCEL_N; r++)
+    {
+        for (w = r * ACCEL_N / 2; w < (r + 1) * ACCEL_N / 2; w++)
+        {
+            if (rows_a & (1u << r))
+            {
+                accel_base[A_PACKED_OFFSET + w] = pack_int16_pair(A, w);
+            }
+            if (rows_b & (1u << r))
+            {
+                accel_base[B_PACKED_OFFSET + w] = pack_int16_pair(B, w);
+            }
+        }
+    }
+    return ROW_VALID_A(rows_a) | ROW_VALID_B(rows_b);
+}
+
+//Same as hardware_matrix_operations_ops() for sparse inputs: all-zero rows are not written at all
+//(ROW_VALID marks them), and with hw_set_zero_skip(1) the accelerator also skips their MAC cycles
+//ROW_VALID is set back to all rows afterwards, so the other functions are not affected
+void hardware_matrix_operations_sparse(const int16_t *A, const int16_t *B, uint32_t ops,
+                                       int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    uint32_t rows;
+
+    ops &= OP_ALL;
+    if (ops == 0)
+    {
+        return;
+    }
+
+    rows = hw_load_ab_sparse(accel_base, A, B);
+    if (rows != ROW_VALID_ALL)
+    {
+        accel_base[ROW_VALID_OFFSET] = rows;
+    }
+    hw_run_and_read(accel_base, 0, ops, HW_Sum, HW_Diff, HW_Prod);
+    if (rows != ROW_VALID_ALL)
+    {
+        accel_base[ROW_VALID_OFFSET] = ROW_VALID_ALL;
+    }
+}
+
+//MAC cycles the accelerator saved with zero skip: of the last job, and in total (total is cleared when reset_total is set)
+void hw_zero_skip_stats(uint32_t *last, uint32_t *total, int reset_total)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    *last = accel_base[SKIP_LAST_OFFSET];
+    *total = accel_base[SKIP_TOTAL_OFFSET];
+    if (reset_total)
+    {
+        accel_base[SKIP_TOTAL_OFFSET] = 0;
+    }
+}
+
+//Layout of the RESULT window: interleaved = 1 gives SUM[i], DIFF[i], PROD[i] per element (the selected ones),
+//interleaved = 0 the selected matrices one after the other; the other MODE bits are kept
+void hw_set_result_layout(int interleaved)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    uint32_t mode = accel_base[MODE_OFFSET] & ~MODE_RES_INTERLEAVE;
+
+    if (interleaved)
+    {
+        mode |= MODE_RES_INTERLEAVE;
+    }
+    accel_base[MODE_OFFSET] = mode;
+}
+
+//Copies the RESULT window of the host bank for a job with op mask ops: RESULT_WORDS(ops) words, nothing else,
+//in the layout set with hw_set_result_layout(); the window is contiguous, so this is one memcpy: with a data
+//cache the lines are filled with bursts (the window's lines are dropped first, so no stale results are
+//copied), without one it is a plain word-by-word copy. Returns the number of words copied
+uint32_t hw_read_result_window(uint32_t ops, int32_t *out)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    void *window = (void *)(uintptr_t)(accel_base + RESULT_OFFSET);
+    uint32_t words = RESULT_WORDS(ops & OP_ALL);
+
+    alt_dcache_flush(window, words * sizeof(uint32_t));
+    memcpy(out, window, words * sizeof(uint32_t));
+    return words;
+}
+
+//Single job with one contiguous readback: out receives RESULT_WORDS(ops) words (see hw_read_result_window())
+//instead of up to three separate reads with casts, e.g. 16 words for ops = OP_MUL
+uint32_t hardware_matrix_operations_window(const int16_t *A, const int16_t *B, uint32_t ops, int32_t *out)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    ops &= OP_ALL;
+    if (ops == 0)
+    {
+        return 0;
+    }
+
+    hw_load_ab_packed(accel_base, A, B);
+    accel_base[CONTROL_OFFSET] = CONTROL_START | CONTROL_OPS(ops);
+    hw_wait_done(accel_base);
+    return hw_read_result_window(ops, out);
+}
+
+//Writes the C operand of the host bank through the B_PACKED window (MODE_C_SELECT), B stays as it is
+//shift is the CHAIN_SHIFT for products fed back into A (0 for plain integers, e.g. 8 for Q8.8 operands)
+static void hw_load_c(volatile uint32_t *accel_base, const int16_t *C, int shift)
+{
+    uint32_t mode = accel_base[MODE_OFFSET] & ~MODE_CHAIN_MASK;
+    int w;
+
+    accel_base[MODE_OFFSET] = mode | MODE_C_SELECT | MODE_CHAIN_SHIFT(shift);
+    for (w = 0; w < ACCEL_NN / 2; w++)
+    {
+        accel_base[B_PACKED_OFFSET + w] = pack_int16_pair(C, w);
+    }
+    accel_base[MODE_OFFSET] = mode | MODE_CHAIN_SHIFT(shift);  //back to writing B
+}
+
+//Sets CHAIN_SHIFT alone, for chains whose C is already loaded (or not needed, CHAIN_FEED)
+void hw_set_chain_shift(int shift)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    accel_base[MODE_OFFSET] = (accel_base[MODE_OFFSET] & ~MODE_CHAIN_MASK) | MODE_CHAIN_SHIFT(shift);
+}
+
+//Prod = A * B, Sum = A * B + C, Diff = A * B - C in one job (CHAIN_ADD_C), e.g. an affine step M * x + b
+//without reading the product back and adding on the CPU; Sum/Diff may be NULL if not wanted
+void hardware_matrix_add_c(const int16_t *A, const int16_t *B, const int16_t *C,
+                           int32_t *HW_Sum, int32_t *HW_Diff, int32_t *HW_Prod)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    uint32_t ops = OP_MUL | (HW_Sum ? OP_ADD : 0) | (HW_Diff ? OP_SUB : 0);
+
+    hw_load_c(accel_base, C, 0);
+    hw_load_ab_packed(accel_base, A, B);
+    hw_run_and_read(accel_base, CONTROL_CHAIN(CHAIN_ADD_C), ops, HW_Sum, HW_Diff, HW_Prod);
+}
+
+//Prod = ((A * B) >> shift) * C in one START (CHAIN_ABC): the intermediate product stays in the accelerator,
+//it is saturated to int16 before the second multiply, so shift has to bring it back into the operand range
+//(a fixed-point format's fraction bits, or 0 if A * B is known to fit)
+void hardware_matrix_chain_abc(const int16_t *A, const int16_t *B, const int16_t *C, int shift, int32_t *HW_Prod)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    hw_load_c(accel_base, C, shift);
+    hw_load_ab_packed(accel_base, A, B);
+    hw_run_and_read(accel_base, CONTROL_CHAIN(CHAIN_ABC), OP_MUL, NULL, NULL, HW_Prod);
+}
+
+//Product chain M[0] * M[1] * ... * M[count-1] (each ACCEL_NN int16 row-major) with the intermediate
+//products kept on-chip, every one shifted right by shift and saturated to int16 (see hardware_matrix_chain_abc())
+//three matrices are one CHAIN_ABC job; longer chains are CHAIN_FEED jobs that only write the next B each
+//(the previous product already is the A), so only the final product is read back
+//count == 1 gives M[0] itself widened to int32 (no accelerator job), count <= 0 leaves HW_Prod untouched
+void hardware_matrix_chain(const int16_t *const *M, int count, int shift, int32_t *HW_Prod)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    int i;
+
+    if (count <= 0)
+    {
+        return;
+    }
+    if (count == 1)
+    {
+        for (i = 0; i < ACCEL_NN; i++)
+        {
+            HW_Prod[i] = M[0][i];
+        }
+        return;
+    }
+    if (count == 2)
+    {
+        hardware_matrix_operations_ops(M[0], M[1], OP_MUL, NULL, NULL, HW_Prod);
+        return;
+    }
+    if (count == 3)
+    {
+        hardware_matrix_chain_abc(M[0], M[1], M[2], shift, HW_Prod);
+        return;
+    }
+
+    hw_set_chain_shift(shift);
+    hw_load_ab_packed(accel_base, M[0], M[1]);
+    for (i = 1; i < count - 1; i++)
+    {
+        if (i > 1)
+        {
+            hw_load_b_packed(accel_base, M[i]);
+        }
+        accel_base[CONTROL_OFFSET] = CONTROL_START | CONTROL_CHAIN(CHAIN_FEED) | CONTROL_OPS(OP_MUL);  //A = (A * M[i]) >> shift
+        hw_wait_done(accel_base);
+    }
+    hw_load_b_packed(accel_base, M[count - 1]);
+    hw_run_and_read(accel_base, 0, OP_MUL, NULL, NULL, HW_Prod);
+}
+
+//Tiled GEMM on the ACCEL_N x ACCEL_N accelerator: C (M x Ncols) = A (M x K) * B (K x Ncols), all row-major
+//with leading dimensions equal to their column counts, and the accelerator's int32 PROD precision
+//Every output tile C[bi][bj] is the sum over bk of A[bi][bk] * B[bk][bj]; the tiles of one output tile
+//are gathered (zero-padded at the edges) into DMA buffers and run as one accumulating batch (OP_MUL | ACCUM),
+//so the accelerator adds up the partial products in its 64-bit accumulators and writes back a single
+//PROD block per output tile: one START/poll and ACCEL_NN result words per output tile, whatever K is
+//When all dimensions are multiples of ACCEL_N there is nothing to pad, and the tiles are fetched in place
+//with the DMA strides instead (hw_gemm_int16_strided()), no gather copy at all
+#ifndef GEMM_MAX_KTILES
+#define GEMM_MAX_KTILES 32  //tile pairs per batch, K up to 32*ACCEL_N in one batch (longer K continues the accumulation)
+#endif
+
+static int16_t gemm_a_tiles[GEMM_MAX_KTILES * ACCEL_NN] __attribute__((aligned(4)));
+static int16_t gemm_b_tiles[GEMM_MAX_KTILES * ACCEL_NN] __attribute__((aligned(4)));
+static int32_t gemm_out[DMA_RESULT_WORDS] __attribute__((aligned(4)));
+
+//Copies the ACCEL_N x ACCEL_N block at (row0, col0) of a rows x cols matrix into tile, zero-padding past the edges
+static void gemm_gather_tile(const int16_t *M, int rows, int cols, int row0, int col0, int16_t *tile)
+{
+    int r, c;
+
+    for (r = 0; r < ACCEL_N; r++)
+    {
+        for (c = 0; c < ACCEL_N; c++)
+        {
+            int mr = row0 + r;
+            int mc = col0 + c;
+            tile[r*ACCEL_N + c] = (mr < rows && mc < cols) ? M[mr*cols + mc] : 0;
+        }
+    }
+}
+
+//In-place version for dimensions that are multiples of ACCEL_N (and 4-byte aligned A and B): no gathering,
+//the accelerator fetches the tiles straight out of A and B with the DMA row strides (K and Ncols elements),
+//A stepping RIGHT and B stepping DOWN from one pair of the accumulating batch to the next
+static void hw_gemm_int16_strided(const int16_t *A, const int16_t *B, int32_t *C, int M, int K, int Ncols)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    int bi, bj, bk, r, c;
+    int ktiles = K / ACCEL_N;
+    const int32_t *prod = gemm_out + 2 * ACCEL_NN;
+
+    alt_dcache_flush((void *)A, (size_t)M * K * sizeof(int16_t));
+    alt_dcache_flush((void *)B, (size_t)K * Ncols * sizeof(int16_t));
+    accel_base[DMA_STRIDE_A_OFFSET] = (uint32_t)K * sizeof(int16_t);
+    accel_base[DMA_STRIDE_B_OFFSET] = (uint32_t)Ncols * sizeof(int16_t);
+    accel_base[DMA_STEP_OFFSET] = DMA_STEP_A(STEP_RIGHT) | DMA_STEP_B(STEP_DOWN);
+
+    for (bi = 0; bi < M; bi += ACCEL_N)
+    {
+        for (bj = 0; bj < Ncols; bj += ACCEL_N)
+        {
+            for (bk = 0; bk < ktiles; bk += BATCH_MAX)
+            {
+                uint32_t count = (ktiles - bk > (int)BATCH_MAX) ? BATCH_MAX : (uint32_t)(ktiles - bk);
+                uint32_t control = CONTROL_START | CONTROL_DMA | CONTROL_OPS(OP_MUL) | CONTROL_ACCUM;
+
+                if (bk == 0)
+                {
+                    control |= CONTROL_CLEAR_ACC;
+                }
+                alt_dcache_flush(gemm_out, DMA_RESULT_WORDS * sizeof(int32_t));
+                accel_base[DMA_SRC_A_OFFSET] = (uint32_t)(uintptr_t)(A + bi*K + bk*ACCEL_N);
+                accel_base[DMA_SRC_B_OFFSET] = (uint32_t)(uintptr_t)(B + bk*ACCEL_N*Ncols + bj);
+                accel_base[DMA_DST_OFFSET] = (uint32_t)(uintptr_t)gemm_out;
+                accel_base[BATCH_COUNT_OFFSET] = count;
+                accel_base[CONTROL_OFFSET] = control;
+                hw_wait_done(accel_base);
+            }
+
+            for (r = 0; r < ACCEL_N; r++)
+            {
+                for (c = 0; c < ACCEL_N; c++)
+                {
+                    C[(bi + r)*Ncols + bj + c] = prod[r*ACCEL_N + c];
+                }
+            }
+        }
+    }
+
+    //back to dense matrices for the other DMA functions
+    accel_base[DMA_STRIDE_A_OFFSET] = 0;
+    accel_base[DMA_STRIDE_B_OFFSET] = 0;
+    accel_base[DMA_STEP_OFFSET] = 0;
+}
+
+void hw_gemm_int16(const int16_t *A, const int16_t *B, int32_t *C, int M, int K, int Ncols)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    int bi, bj, bk, t, r, c;
+    int ktiles = (K + ACCEL_N - 1) / ACCEL_N;
+    const int32_t *prod = gemm_out + 2 * ACCEL_NN;  //PROD part of the result block
+
+    if (M % ACCEL_N == 0 && K % ACCEL_N == 0 && Ncols % ACCEL_N == 0 &&
+        ((uintptr_t)A & 3) == 0 && ((uintptr_t)B & 3) == 0)
+    {
+        hw_gemm_int16_strided(A, B, C, M, K, Ncols);
+        return;
+    }
+
+    for (bi = 0; bi < M; bi += ACCEL_N)
+    {
+        for (bj = 0; bj < Ncols; bj += ACCEL_N)
+        {
+            for (bk = 0; bk < ktiles; bk += GEMM_MAX_KTILES)
+            {
+                int count = (ktiles - bk > GEMM_MAX_KTILES) ? GEMM_MAX_KTILES : ktiles - bk;
+                uint32_t control = CONTROL_START | CONTROL_DMA | CONTROL_OPS(OP_MUL) | CONTROL_ACCUM;
+
+                for (t = 0; t < count; t++)
+                {
+                    gemm_gather_tile(A, M, K, bi, (bk + t) * ACCEL_N, gemm_a_tiles + t * ACCEL_NN);
+                    gemm_gather_tile(B, K, Ncols, (bk + t) * ACCEL_N, bj, gemm_b_tiles + t * ACCEL_NN);
+                }
+
+                if (bk == 0)
+                {
+                    control |= CONTROL_CLEAR_ACC;  //new output tile, start the accumulation from zero
+                }
+                hw_dma_setup(accel_base, gemm_a_tiles, gemm_b_tiles, gemm_out, (uint32_t)count, 1);
+                accel_base[CONTROL_OFFSET] = control;
+                hw_wait_done(accel_base);
+            }
+
+            //Store the tile, without the zero padding
+            for (r = 0; r < ACCEL_N && bi + r < M; r++)
+            {
+                for (c = 0; c < ACCEL_N && bj + c < Ncols; c++)
+                {
+                    C[(bi + r)*Ncols + bj + c] = prod[r*ACCEL_N + c];
+                }
+            }
+        }
+    }
+}
+
+//Accumulate-in-place over the slave windows: PROD += A * B, without reading anything back
+//clear = 1 starts a new sum (the accumulators are zeroed before this product is added)
+void hw_matrix_accumulate(const int16_t *A, const int16_t *B, int clear)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    uint32_t control = CONTROL_START | CONTROL_OPS(OP_MUL) | CONTROL_ACCUM;
+
+    if (clear)
+    {
+        control |= CONTROL_CLEAR_ACC;
+    }
+    hw_load_ab_packed(accel_base, A, B);
+    accel_base[CONTROL_OFFSET] = control;
+    hw_wait_done(accel_base);
+}
+
+//Reads the accumulated product (lower 32 bits of each accumulator) after a chain of hw_matrix_accumulate()
+void hw_matrix_accumulate_read(int32_t *C)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    int i;
+
+    for (i = 0; i < ACCEL_NN; i++)
+    {
+        C[i] = (int32_t)accel_base[PROD_OFFSET + i];
+    }
+}
+
+//Zeroes the accumulators without starting a job; CONTROL is write-only, so this also selects bank 0 for
+//the windows (HOST_BANK = 0), a caller working on bank 1 has to select it again afterwards
+void hw_clear_accumulators(void)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    accel_base[CONTROL_OFFSET] = CONTROL_CLEAR_ACC;  //no START, also selects bank 0 for the windows
+}
+
+//Performance counters of the accelerator (accelerator clock cycles and beats, see PERF_* in matrix_accel_regs.h)
+struct hw_perf
+{
+    uint32_t cyc_load;       //LOAD_AB: loading operands over the slave / waiting for START
+    uint32_t cyc_fetch;      //FETCH: operands coming in over DMA or the stream sink
+    uint32_t cyc_run;        //RUN: compute
+    uint32_t cyc_writeback;  //WRITEBACK: results going out over DMA or the stream source
+    uint32_t cyc_done;       //DONE: results waiting for the host
+    uint32_t jobs;
+    uint32_t bus_reads;
+    uint32_t bus_writes;
+    uint32_t idle;           //nothing running or pending (part of cyc_load + cyc_done)
+    uint32_t dma_reads;
+    uint32_t dma_writes;
+};
+
+//Zeroes the counters and lets them run
+void hw_perf_clear(void)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+
+    accel_base[PERF_CTRL_OFFSET] = PERF_CTRL_CLEAR;
+}
+
+//Reads a consistent snapshot: the counters are frozen while they are read, then run on
+//(the reads of this function itself are counted in bus_reads up to the freeze)
+void hw_perf_read(struct hw_perf *p)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    volatile uint32_t *perf = accel_base + PERF_OFFSET;
+
+    accel_base[PERF_CTRL_OFFSET] = PERF_CTRL_FREEZE;
+    p->cyc_load = perf[PERF_CYC_LOAD];
+    p->cyc_fetch = perf[PERF_CYC_FETCH];
+    p->cyc_run = perf[PERF_CYC_RUN];
+    p->cyc_writeback = perf[PERF_CYC_WRITEBACK];
+    p->cyc_done = perf[PERF_CYC_DONE];
+    p->jobs = perf[PERF_JOBS];
+    p->bus_reads = perf[PERF_BUS_READS];
+    p->bus_writes = perf[PERF_BUS_WRITES];
+    p->idle = perf[PERF_IDLE];
+    p->dma_reads = perf[PERF_DMA_READS];
+    p->dma_writes = perf[PERF_DMA_WRITES];
+    accel_base[PERF_CTRL_OFFSET] = 0;  //unfreeze
+}
+
+void hw_perf_print(const struct hw_perf *p)
+{
+    printf("Accelerator cycles: load %u, fetch %u, run %u, writeback %u, done %u (idle %u)\n",
+           p->cyc_load, p->cyc_fetch, p->cyc_run, p->cyc_writeback, p->cyc_done, p->idle);
+    printf("Jobs: %u, slave reads/writes: %u/%u, DMA reads/writes: %u/%u\n",
+           p->jobs, p->bus_reads, p->bus_writes, p->dma_reads, p->dma_writes);
+}
+
+//Hybrid dispatcher: runs each call on the path that the calibrated cost model says is fastest
+//DISPATCH_SW   – software_matrix_operations() on the CPU (the same cost for every op mask)
+//DISPATCH_MMIO – hardware_matrix_operations_ops(), packed loads and reads over the slave
+//DISPATCH_DMA  – DMA batches; the CPU computes jobs from the front of the batch while the accelerator
+//                works through chunks from the back, so both paths are busy until they meet
+//The costs are timer cycles measured by dispatch_calibrate() on this system (so they include the
+//interconnect, the caches and the clock ratio); before that every call goes to the slave as before.
+//Calibration starts DMA batches, so it is opt-in: only call it when the DMA master is connected
+//(main() does only in the BENCH_SUITE build, the interactive program never calibrates)
+#define DISPATCH_SW 0
+#define DISPATCH_MMIO 1
+#define DISPATCH_DMA 2
+
+#ifndef DISPATCH_CAL_RUNS
+#define DISPATCH_CAL_RUNS 8     //timed runs per measurement, the fastest one is used
+#endif
+#ifndef DISPATCH_CAL_BATCH
+#define DISPATCH_CAL_BATCH 16   //second batch size for the DMA cost line (setup + n * per job)
+#endif
+
+struct dispatch_costs
+{
+    int valid;                //dispatch_calibrate() has run
+    uint32_t sw;              //one job in software
+    uint32_t mmio[OP_ALL + 1];       //one job over the slave, per op mask
+    uint32_t dma_setup[OP_ALL + 1];  //fixed cost of one DMA batch (setup, START, DONE poll), per op mask
+    uint32_t dma_job[OP_ALL + 1];    //added cost per pair of a DMA batch, per op mask
+};
+
+static struct dispatch_costs dispatch_cost;
+
+static int16_t dispatch_cal_a[DISPATCH_CAL_BATCH * ACCEL_NN] __attribute__((aligned(32)));
+static int16_t dispatch_cal_b[DISPATCH_CAL_BATCH * ACCEL_NN] __attribute__((aligned(32)));
+static int32_t dispatch_cal_out[DISPATCH_CAL_BATCH * DMA_RESULT_WORDS] __attribute__((aligned(32)));
+
+//Fastest of DISPATCH_CAL_RUNS runs of one path (DMA: a batch of n pairs)
+static uint32_t dispatch_measure(int path, uint32_t ops, size_t n)
+{
+    struct prof_timer t;
+    int run;
+
+    prof_reset(&t);
+    for (run = 0; run < DISPATCH_CAL_RUNS; run++)
+    {
+        prof_start(&t);
+        if (path == DISPATCH_SW)
+        {
+            software_matrix_operations(dispatch_cal_a, dispatch_cal_b, dispatch_cal_out,
+                                       dispatch_cal_out + ACCEL_NN, dispatch_cal_out + 2 * ACCEL_NN);
+        } else if (path == DISPATCH_MMIO)
+        {
+            hardware_matrix_operations_ops(dispatch_cal_a, dispatch_cal_b, ops, dispatch_cal_out,
+                                           dispatch_cal_out + ACCEL_NN, dispatch_cal_out + 2 * ACCEL_NN);
+        } else
+        {
+            hw_matrix_batch_ops(dispatch_cal_a, dispatch_cal_b, dispatch_cal_out, n, ops);
+        }
+        prof_stop(&t);
+    }
+    return t.min;
+}
+
+//Measures every path and op mask once, call after prof_init() while the accelerator is idle
+//(needs the DMA master: without it the DMA batches never finish)
+void dispatch_calibrate(void)
+{
+    uint32_t ops, t1, tn;
+    int i;
+
+    for (i = 0; i < DISPATCH_CAL_BATCH * ACCEL_NN; i++)
+    {
+        dispatch_cal_a[i] = (int16_t)(i * 37 - 300);  //any values, the paths take the same time for all inputs
+        dispatch_cal_b[i] = (int16_t)(250 - i * 11);
+    }
+
+    dispatch_cost.sw = dispatch_measure(DISPATCH_SW, OP_ALL, 1);
+    for (ops = 1; ops <= OP_ALL; ops++)
+    {
+        dispatch_cost.mmio[ops] = dispatch_measure(DISPATCH_MMIO, ops, 1);
+        t1 = dispatch_measure(DISPATCH_DMA, ops, 1);
+        tn = dispatch_measure(DISPATCH_DMA, ops, DISPATCH_CAL_BATCH);
+        dispatch_cost.dma_job[ops] = (tn > t1) ? (tn - t1) / (DISPATCH_CAL_BATCH - 1) : 0;
+        dispatch_cost.dma_setup[ops] = (t1 > dispatch_cost.dma_job[ops]) ? t1 - dispatch_cost.dma_job[ops] : 0;
+    }
+    dispatch_cost.valid = 1;
+}
+
+void dispatch_print_costs(void)
+{
+    uint32_t ops;
+
+    printf("Dispatch costs (cycles): software %u per job\n", (unsigned)dispatch_cost.sw);
+    for (ops = 1; ops <= OP_ALL; ops++)
+    {
+        printf("  ops %u: slave %u per job, DMA %u + %u per job\n", (unsigned)ops,
+               (unsigned)dispatch_cost.mmio[ops], (unsigned)dispatch_cost.dma_setup[ops], (unsigned)dispatch_cost.dma_job[ops]);
+    }
+}
+
+//Estimated cycles of n jobs with ops on one path
+static uint64_t dispatch_estimate(int path, uint32_t ops, size_t n)
+{
+    if (path == DISPATCH_SW)
+    {
+        return (uint64_t)n * dispatch_cost.sw;
+    } else if (path == DISPATCH_MMIO)
+    {
+        return (uint64_t)n * dispatch_cost.mmio[ops];
+    }
+    return (uint64_t)((n + BATCH_MAX - 1) / BATCH_MAX) * dispatch_cost.dma_setup[ops] + (uint64_t)n * dispatch_cost.dma_job[ops];
+}
+
+//Fastest path for n jobs with ops (DISPATCH_DMA only for n > 1, a single job has no batch to share)
+int dispatch_choose(uint32_t ops, size_t n)
+{
+    int best = DISPATCH_MMIO;
+
+    ops &= OP_ALL;
+    if (!dispatch_cost.valid || ops == 0)
+    {
+        return DISPATCH_MMIO;
+    }
+    if (dispatch_estimate(DISPATCH_SW, ops, n) < dispatch_estimate(best, ops, n))
+    {
+        best = DISPATCH_SW;
+    }
+    if (n > 1 && dispatch_estimate(DISPATCH_DMA, ops, n) < dispatch_estimate(best, ops, n))
+    {
+        best = DISPATCH_DMA;
+    }
+    return best;
+}
+
+//Single job on the faster of software and the slave; always software while the accelerator is busy
+//(e.g. with an async batch or stream jobs), returns the path used
+int dispatch_matrix_operations(const int16_t *A, const int16_t *B, uint32_t ops,
+                               int32_t *Sum, int32_t *Diff, int32_t *Prod)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    int path = dispatch_choose(ops, 1);
+
+    if ((ops & OP_ALL) == 0)
+    {
+        return DISPATCH_SW;
+    }
+    if (path != DISPATCH_SW && (accel_base[STATUS_OFFSET] & STATUS_BUSY))
+    {
+        path = DISPATCH_SW;
+    }
+    if (path == DISPATCH_SW)
+    {
+        software_matrix_operations(A, B, Sum, Diff, Prod);  //computes all three, whatever ops is
+    } else
+    {
+        hardware_matrix_operations_ops(A, B, ops, Sum, Diff, Prod);
+    }
+    return path;
+}
+
+//Shared batch: the CPU takes jobs from lo upwards, the accelerator takes DMA chunks from hi downwards,
+//each chunk sized so that it should finish when the CPU has done the rest of its share; a new chunk is only
+//started while the accelerator is idle, so a busy accelerator simply leaves more jobs to the CPU
+static void dispatch_shared_batch(const int16_t *A, const int16_t *B, int32_t *out, size_t n, uint32_t ops)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    uint64_t sw = dispatch_cost.sw;
+    uint64_t setup = dispatch_cost.dma_setup[ops];
+    uint64_t job = dispatch_cost.dma_job[ops];
+    size_t lo = 0, hi = n;
+    int in_flight = 0;
+
+    while (lo < hi || in_flight)
+    {
+        uint32_t status = accel_base[STATUS_OFFSET];
+
+        if (in_flight && (status & STATUS_DONE) && !(status & STATUS_BUSY))
+        {
+            in_flight = 0;
+        }
+        if (!in_flight && lo < hi && !(status & STATUS_BUSY))
+        {
+            //chunk c balances setup + c * job against (remaining - c) * sw
+            uint64_t rem = hi - lo;
+            uint64_t c = (rem * sw > setup) ? (rem * sw - setup) / (sw + job) : 0;
+
+            if (c > BATCH_MAX)
+            {
+                c = BATCH_MAX;
+            }
+            if (c > 0)
+            {
+                hi -= (size_t)c;
+                hw_dma_setup(accel_base, A + hi * ACCEL_NN, B + hi * ACCEL_NN, out + hi * DMA_RESULT_WORDS,
+                             (uint32_t)c, (uint32_t)c);
+                accel_base[CONTROL_OFFSET] = CONTROL_START | CONTROL_DMA | CONTROL_OPS(ops);
+                in_flight = 1;
+            }
+        }
+        if (lo < hi)
+        {
+            int32_t *o = out + lo * DMA_RESULT_WORDS;
+
+            software_matrix_operations(A + lo * ACCEL_NN, B + lo * ACCEL_NN, o, o + ACCEL_NN, o + 2 * ACCEL_NN);
+            lo++;
+        }
+    }
+}
+
+//Batch of n pairs on the path the cost model picks, A/B/out as for hw_matrix_batch_ops(); the software
+//part fills all three results of its blocks, whatever ops is
+//out must be aligned to the data cache line (32 bytes): the CPU and the DMA master write neighbouring
+//result blocks at the same time, they must not share a cache line
+void dispatch_matrix_batch(const int16_t *A, const int16_t *B, int32_t *out, size_t n, uint32_t ops)
+{
+    volatile uint32_t *accel_base = (uint32_t *)MATRIX_ACCEL_BASE;
+    int path;
+    size_t j;
+
+    ops &= OP_ALL;
+    if (ops == 0 || n == 0)
+    {
+        return;
+    }
+
+    path = dispatch_choose(ops, n);
+    if (path == DISPATCH_MMIO && (accel_base[STATUS_OFFSET] & STATUS_BUSY))
+    {
+        path = DISPATCH_SW;
+    }
+    if (path == DISPATCH_DMA)
+    {
+        dispatch_shared_batch(A, B, out, n, ops);
+        return;
+    }
+    for (j = 0; j < n; j++)
+    {
+        int32_t *o = out + j * DMA_RESULT_WORDS;
+
+        if (path == DISPATCH_SW)
+        {
+            software_matrix_operations(A + j * ACCEL_NN, B + j * ACCEL_NN, o, o + ACCEL_NN, o + 2 * ACCEL_NN);
+        } else
+        {
+            hardware_matrix_operations_ops(A + j * ACCEL_NN, B + j * ACCEL_NN, ops, o, o + ACCEL_NN, o + 2 * ACCEL_NN);
+        }
+    }
+}
+
+#ifdef BENCH_SUITE
+//Non-interactive benchmark suite (build with -DBENCH_SUITE): BENCH_JOBS seeded random pairs in the safe range
+//go through every load strategy, operation mask and batch size, every result is checked against
+//software_matrix_operations_naive(), and one CSV line per configuration is printed on stdout (the JTAG UART):
+//  strategy,ops,batch,jobs,min,median,p99,avg,jobs_per_s,slave_bytes_per_job,dma_bytes_per_job,kbytes_per_s,mismatches
+//min/median/p99/avg are timer cycles per job (one sample per call, a batch call's cycles divided by its size),
+//the byte counts come from the accelerator's performance counters (STATUS polls included), kbytes_per_s is
+//slave + DMA traffic over the measured time; the one-off B load of the reuse_b strategies is not timed
+#ifndef BENCH_JOBS
+#define BENCH_JOBS 256
+#endif
+#ifndef BENCH_SEED
+#define BENCH_SEED 1
+#endif
+
+#define STRAT_SW_NAIVE 0     //software_matrix_operations_naive()
+#define STRAT_SW 1           //software_matrix_operations()
+#define STRAT_PACKED 2       //hardware_matrix_operations_ops(), packed windows, one job per call
+#define STRAT_REUSE_B 3      //hw_load_a_and_run_ops(), B loaded once, only A per job
+#define STRAT_DMA 4          //hw_matrix_batch_ops()
+#define STRAT_DMA_REUSE_B 5  //hw_matrix_batch_loaded_b(), B loaded once like reuse_b, only A per job
+#define STRAT_DISPATCH 6     //dispatch_matrix_batch(), cost-model choice
+#define STRAT_CI 7           //hardware_matrix_operations_path(HW_PATH_CI), only with MATRIX_CI_BASE
+#ifdef MATRIX_CI_BASE
+#define STRAT_COUNT 8
+#else
+#define STRAT_COUNT 7
+#endif
+
+static const char *const bench_strategy_names[] = { "sw_naive", "sw", "packed", "reuse_b", "dma", "dma_reuse_b", "dispatch", "ci" };
+static const uint32_t bench_ops_list[] = { OP_ADD, OP_SUB, OP_MUL, OP_ALL };
+static const size_t bench_batch_list[] = { 1, 4, 16, 64, BENCH_JOBS };
+
+static int16_t bench_a[BENCH_JOBS * ACCEL_NN] __attribute__((aligned(32)));
+static int16_t bench_b[BENCH_JOBS * ACCEL_NN] __attribute__((aligned(32)));
+static int32_t bench_out[BENCH_JOBS * DMA_RESULT_WORDS] __attribute__((aligned(32)));  //cache line aligned, for dispatch
+static uint32_t bench_samples[BENCH_JOBS];
+static uint32_t bench_rand_state;
+
+//Small LCG, so a seed gives the same inputs on every build and run
+static int16_t bench_rand_elem(void)
+{
+    bench_rand_state = bench_rand_state * 1664525u + 1013904223u;
+    return (int16_t)((int32_t)((bench_rand_state >> 8) % (2 * SAFE_INPUT_MAX + 1)) - SAFE_INPUT_MAX);
+}
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+//Checks the selected parts of the result blocks against the naive software version, B is shared when reuse is set
+static uint32_t bench_check(uint32_t ops, int reuse)
+{
+    int32_t ref[DMA_RESULT_WORDS];
+    uint32_t bad = 0;
+    size_t j;
+
+    for (j = 0; j < BENCH_JOBS; j++)
+    {
+        const int16_t *b = reuse ? bench_b : bench_b + j * ACCEL_NN;
+        const int32_t *o = bench_out + j * DMA_RESULT_WORDS;
+
+        software_matrix_operations_naive(bench_a + j * ACCEL_NN, b, ref, ref + ACCEL_NN, ref + 2 * ACCEL_NN);
+        if (((ops & OP_ADD) && memcmp(o, ref, ACCEL_NN * sizeof(int32_t)) != 0) ||
+            ((ops & OP_SUB) && memcmp(o + ACCEL_NN, ref + ACCEL_NN, ACCEL_NN * sizeof(int32_t)) != 0) ||
+            ((ops & OP_MUL) && memcmp(o + 2 * ACCEL_NN, ref + 2 * ACCEL_NN, ACCEL_NN * sizeof(int32_t)) != 0))
+        {
+            bad++;
+        }
+    }
+    return bad;
+}
+
+//Runs all BENCH_JOBS pairs with one strategy, ops and batch size and prints the CSV line
+static void bench_run(int strategy, uint32_t ops, size_t batch)
+{
+    struct prof_timer t;
+    struct hw_perf perf;
+    int reuse = (strategy == STRAT_REUSE_B || strategy == STRAT_DMA_REUSE_B);
+    size_t j, count, n = 0;
+    uint64_t slave_bytes, dma_bytes, freq = prof_freq();
+    uint32_t bad;
+
+    memset(bench_out, 0, sizeof(bench_out));
+    if (reuse)
+    {
+        hw_load_b(bench_b);  //every job uses the first B, loaded before the timer and the counters start
+    }
+
+    prof_reset(&t);
+    hw_perf_clear();
+    for (j = 0; j < BENCH_JOBS; j += count)
+    {
+        const int16_t *a = bench_a + j * ACCEL_NN;
+        const int16_t *b = reuse ? bench_b : bench_b + j * ACCEL_NN;
+        int32_t *o = bench_out + j * DMA_RESULT_WORDS;
+
+        count = (BENCH_JOBS - j > batch) ? batch : BENCH_JOBS - j;
+        prof_start(&t);
+        switch (strategy)
+        {
+            case STRAT_SW_NAIVE:
+                software_matrix_operations_naive(a, b, o, o + ACCEL_NN, o + 2 * ACCEL_NN);
+                break;
+            case STRAT_SW:
+                software_matrix_operations(a, b, o, o + ACCEL_NN, o + 2 * ACCEL_NN);
+                break;
+            case STRAT_PACKED:
+                hardware_matrix_operations_ops(a, b, ops, o, o + ACCEL_NN, o + 2 * ACCEL_NN);
+                break;
+            case STRAT_REUSE_B:
+                hw_load_a_and_run_ops(a, ops, o, o + ACCEL_NN, o + 2 * ACCEL_NN);
+                break;
+            case STRAT_DMA:
+                hw_matrix_batch_ops(a, b, o, count, ops);
+                break;
+            case STRAT_DISPATCH:
+                dispatch_matrix_batch(a, b, o, count, ops);
+                break;
+            case STRAT_CI:
+                hardware_matrix_operations_path(a, b, ops, o, o + ACCEL_NN, o + 2 * ACCEL_NN, HW_PATH_CI);
+                break;
+            case STRAT_DMA_REUSE_B:
+                hw_matrix_batch_loaded_b(a, o, count, ops);
+                break;
+            default:
+                break;
+        }
+        prof_stop(&t);
+        bench_samples[n++] = (uint32_t)((t.last + count / 2) / count);
+    }
+    hw_perf_read(&perf);
+    bad = bench_check(ops, reuse);
+
+    qsort(bench_samples, n, sizeof(bench_samples[0]), bench_cmp_u32);
+    slave_bytes = ((uint64_t)perf.bus_reads + perf.bus_writes) * 4;
+    dma_bytes = ((uint64_t)perf.dma_reads + perf.dma_writes) * 4;
+    if (strategy == STRAT_SW || strategy == STRAT_SW_NAIVE)
+    {
+        slave_bytes = 0;  //the counters only saw the CLEAR/FREEZE writes
+        dma_bytes = 0;
+    }
+    printf("%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", bench_strategy_names[strategy],
+           (unsigned)ops, (unsigned)batch, (unsigned)BENCH_JOBS,
+           (unsigned)bench_samples[0], (unsigned)bench_samples[n / 2],
+           (unsigned)bench_samples[(n * 99 + 99) / 100 - 1],  //p99, nearest rank
+           (unsigned)((t.total + BENCH_JOBS / 2) / BENCH_JOBS),
+           (unsigned)((t.total == 0) ? 0 : (uint64_t)BENCH_JOBS * freq / t.total),
+           (unsigned)(slave_bytes / BENCH_JOBS), (unsigned)(dma_bytes / BENCH_JOBS),
+           (unsigned)((t.total == 0) ? 0 : (slave_bytes + dma_bytes) * freq / t.total / 1000),
+           (unsigned)bad);
+}
+
+void bench_suite(void)
+{
+    size_t i, b;
+    int s;
+
+    bench_rand_state = BENCH_SEED;
+    for (i = 0; i < BENCH_JOBS * ACCEL_NN; i++)
+    {
+        bench_a[i] = bench_rand_elem();
+        bench_b[i] = bench_rand_elem();
+    }
+
+    printf("strategy,ops,batch,jobs,min,median,p99,avg,jobs_per_s,slave_bytes_per_job,dma_bytes_per_job,kbytes_per_s,mismatches\n");
+    bench_run(STRAT_SW_NAIVE, OP_ALL, 1);  //software always computes all three
+    bench_run(STRAT_SW, OP_ALL, 1);
+    for (s = STRAT_PACKED; s < STRAT_COUNT; s++)
+    {
+        for (i = 0; i < sizeof(bench_ops_list) / sizeof(bench_ops_list[0]); i++)
+        {
+            if (s == STRAT_DMA || s == STRAT_DMA_REUSE_B || s == STRAT_DISPATCH)
+            {
+                for (b = 0; b < sizeof(bench_batch_list) / sizeof(bench_batch_list[0]); b++)
+                {
+                    bench_run(s, bench_ops_list[i], bench_batch_list[b]);
+                }
+            } else
+            {
+                bench_run(s, bench_ops_list[i], 1);  //the slave paths are one job per call
+            }
+        }
+    }
+    printf("done\n");
+}
+#endif
+
+int main() 
+{
+    int16_t A[ACCEL_N][ACCEL_N];   //16-bit signed to match hardware input
+    int16_t B[ACCEL_N][ACCEL_N];   //16-bit signed to match hardware input
+    int32_t SW_Prod[ACCEL_N][ACCEL_N];  //32-bit signed (result fits in 32 bits for safe range)
+    int32_t SW_Sum[ACCEL_N][ACCEL_N];   //32-bit signed (same as above.....)
+    int32_t SW_Diff[ACCEL_N][ACCEL_N];  //32-bit signed
+
+    int32_t HW_Sum[ACCEL_NN];   //32-bit signed to match hardware output
+    int32_t HW_Diff[ACCEL_NN];  //32-bit signed to match hardware output
+    int32_t HW_Prod[ACCEL_NN];  //32-bit signed to match hardware output
+
+    struct prof_timer sw_timer, hw_timer, cached_timer;
+    uint32_t speedup_x100;
+    int run;
+    struct hw_perf perf;  //accelerator counters of the hardware run
+    int i, j;  //i and j are normal integer loop counters, so %d format specifier is used in printf and scanf
+             //unlike, int16_t uses %hd, int32_t uses %d format specifiers
+    char cont; //to store user choice to continue or not(Y/N)
+    
+    prof_init();  //start the timer and measure the start/stop overhead once
+
+#ifdef BENCH_SUITE
+    dispatch_calibrate();  //per-path costs for the dispatcher; uses DMA, like the batch strategies of the suite
+    bench_suite();  //no prompts, CSV only
+    return 0;
+#endif
+    
+    while (1) 
+    {
+        printf("\n");  
+        //to take input elements of matrix A from user and print prompts accordingly
+        printf("Enter Matrix A (%dx%d) - 16-bit signed (safe range: -%d to %d):\n", 
+               ACCEL_N, ACCEL_N, SAFE_INPUT_MAX, SAFE_INPUT_MAX);
+        for (i = 0; i < ACCEL_N; i++) 
+        {
+            for (j = 0; j < ACCEL_N; j++) 
+            {
+                printf("A[%d][%d] = ", i, j);
+                scanf("%hd", &A[i][j]);  // Changed to %hd for int16_t
+            }
+        }
+        
+        //to take input elements of matrix B from user and print prompts accordingly
+        printf("\nEnter Matrix B (%dx%d) - 16-bit signed (safe range: -%d to %d):\n", 
+               ACCEL_N, ACCEL_N, SAFE_INPUT_MAX, SAFE_INPUT_MAX);
+        for (i = 0; i < ACCEL_N; i++) 
+        {
+            for (j = 0; j < ACCEL_N; j++) 
+            {
+                printf("B[%d][%d] = ", i, j);
+                scanf("%hd", &B[i][j]);  //Changed to %hd for int16_t
+            }
+        }
+
+        // Print input matrices A and B
+        printf("\n_________INPUT MATRICES__________\n");
+        printf("\nMatrix A:\n");
+        for (i = 0; i < ACCEL_N; i++) 
+        {
+            for (j = 0; j < ACCEL_N; j++) 
+            {
+                printf("%d ", A[i][j]);
+            }
+            printf("\n");
+        }
+        
+        printf("\nMatrix B:\n");
+        for (i = 0; i < ACCEL_N; i++) 
+        {
+            for (j = 0; j < ACCEL_N; j++) 
+            {
+                printf("%d ", B[i][j]);
+            }
+            printf("\n");
+        }
+
+        // SOFTWARE: Matrix operations with timing
+        prof_reset(&sw_timer);
+        for (run = 0; run < BENCH_RUNS; run++)
+        {
+            prof_start(&sw_timer);
+            software_matrix_operations((int16_t *)A, (int16_t *)B, (int32_t *)SW_Sum, (int32_t *)SW_Diff, (int32_t *)SW_Prod);
+            prof_stop(&sw_timer);
+        }
+
+        // HARDWARE: Matrix operations with timing
+        prof_reset(&hw_timer);
+        hw_perf_clear();          //before the first run, so the CLEAR is not timed
+        for (run = 0; run < BENCH_RUNS; run++)
+        {
+            prof_start(&hw_timer);
+            hardware_matrix_operations((int16_t *)A, (int16_t *)B, HW_Sum, HW_Diff, HW_Prod);
+            prof_stop(&hw_timer);
+        }
+        hw_perf_read(&perf);
+
+        // HARDWARE with the result cache: the first run misses, the repeats are hits
+        prof_reset(&cached_timer);
+        result_cache_clear();
+        result_cache_reset_stats();
+        for (run = 0; run < BENCH_RUNS; run++)
+        {
+            prof_start(&cached_timer);
+            hardware_matrix_operations_cached((int16_t *)A, (int16_t *)B, HW_Sum, HW_Diff, HW_Prod);
+            prof_stop(&cached_timer);
+        }
 
         //To print result from software matrix multiplication
         //the result matrix is computed in the subroutine above, and each element is calculated 
         //and each element is stored in its respective position by using pointer SW_Result
         printf("\n_________SOFTWARE RESULTS__________\n");
         printf("\nSoftware Result Matrix SW_Prod = A * B\n");
-        for (i = 0; i < 4; i++) 
+        for (i = 0; i < ACCEL_N; i++) 
         {
-            for (j = 0; j < 4; j++) 
+            for (j = 0; j < ACCEL_N; j++) 
             {
                 printf("%d ", SW_Prod[i][j]);  
             }
@@ -228,9 +1942,9 @@ int main()
         }
         
         printf("\nSoftware Sum Matrix SW_Sum = A + B\n");
-        for (i = 0; i < 4; i++) 
+        for (i = 0; i < ACCEL_N; i++) 
         {
-            for (j = 0; j < 4; j++) 
+            for (j = 0; j < ACCEL_N; j++) 
             {
                 printf("%d ", SW_Sum[i][j]);  
             }
@@ -238,9 +1952,9 @@ int main()
         }
         
         printf("\nSoftware Diff Matrix SW_Diff = A - B\n");
-        for (i = 0; i < 4; i++) 
+        for (i = 0; i < ACCEL_N; i++) 
         {
-            for (j = 0; j < 4; j++) 
+            for (j = 0; j < ACCEL_N; j++) 
             {
                 printf("%d ", SW_Diff[i][j]);  
             }
@@ -249,41 +1963,44 @@ int main()
         
         printf("\n______________ HARDWARE RESULTS ____________\n");
         printf("\nHardware Product Matrix HW_Prod = A * B\n");
-        for (i = 0; i < 4; i++) 
+        for (i = 0; i < ACCEL_N; i++) 
         {
-            for (j = 0; j < 4; j++) 
+            for (j = 0; j < ACCEL_N; j++) 
             {
-                printf("%d ", HW_Prod[i*4 + j]);  
+                printf("%d ", HW_Prod[i*ACCEL_N + j]);  
             }
             printf("\n");
         }
         
         printf("\nHardware Sum Matrix HW_Sum = A + B\n");
-        for (i = 0; i < 4; i++) 
+        for (i = 0; i < ACCEL_N; i++) 
         {
-            for (j = 0; j < 4; j++) 
+            for (j = 0; j < ACCEL_N; j++) 
             {
-                printf("%d ", HW_Sum[i*4 + j]);  
+                printf("%d ", HW_Sum[i*ACCEL_N + j]);  
             }
             printf("\n");
         }
         
         printf("\nHardware Diff Matrix HW_Diff = A - B\n");
-        for (i = 0; i < 4; i++) 
+        for (i = 0; i < ACCEL_N; i++) 
         {
-            for (j = 0; j < 4; j++) 
+            for (j = 0; j < ACCEL_N; j++) 
             {
-                printf("%d ", HW_Diff[i*4 + j]);  
+                printf("%d ", HW_Diff[i*ACCEL_N + j]);  
             }
             printf("\n");
         }
 
         printf("\n________ PERFORMANCE COMPARISON ______________\n");
-        printf("Software Clock Cycles: %u\n", sw_cycles);
-        printf("Hardware Clock Cycles: %u\n", hw_cycles);
+        prof_print("Software Clock Cycles", &sw_timer);
+        prof_print("Hardware Clock Cycles", &hw_timer);
         
-        int speedup = (sw_cycles / hw_cycles);
-        printf("Speedup: %dx\n", speedup);
+        speedup_x100 = prof_ratio_x100(&sw_timer, &hw_timer);  //from the 64-bit totals, not truncated
+        printf("Speedup: %u.%02ux\n", (unsigned)(speedup_x100 / 100), (unsigned)(speedup_x100 % 100));
+        hw_perf_print(&perf);  //where the hardware cycles went (all BENCH_RUNS runs)
+        prof_print("Cached hardware Clock Cycles", &cached_timer);
+        result_cache_print_stats();
 
         printf("\nDo you want to continue (Y/N)? ");
         scanf(" %c", &cont);
@@ -0,0 +1,118 @@
+//Cycle profiling for the Nios II benchmarks, see nios2_profile.h
+#include <stdio.h>
+#include "nios2_profile.h"
+#ifdef PROF_USE_HAL_TIMESTAMP
+#include <sys/alt_timestamp.h>
+#endif
+
+uint32_t prof_overhead = 0;
+
+void prof_init(void)
+{
+    struct prof_timer t;
+    int i;
+
+#ifdef PROF_USE_HAL_TIMESTAMP
+    alt_timestamp_start();
+#else
+    volatile uint32_t *timer = (uint32_t *)TIMER_BASE;
+
+    //Free-running: full period, reload at zero, so every snapshot is valid and differences wrap cleanly
+    timer[TIMER_PERIODL] = 0xFFFF;
+    timer[TIMER_PERIODH] = 0xFFFF;
+    timer[TIMER_CONTROL] = TIMER_CONTROL_CONT | TIMER_CONTROL_START;
+#endif
+
+    //Overhead: the shortest of several empty start/stop pairs (the first one may include cache misses)
+    prof_overhead = 0;
+    prof_reset(&t);
+    for (i = 0; i < PROF_CALIBRATE_RUNS; i++)
+    {
+        prof_start(&t);
+        prof_stop(&t);
+    }
+    prof_overhead = t.min;
+}
+
+uint32_t prof_now(void)
+{
+#ifdef PROF_USE_HAL_TIMESTAMP
+    return (uint32_t)alt_timestamp();  //the low 32 bits are enough, intervals are taken modulo 2^32
+#else
+    volatile uint32_t *timer = (uint32_t *)TIMER_BASE;
+    uint32_t snap;
+
+    timer[TIMER_SNAPL] = 1;  //any write latches the whole counter into SNAPL/SNAPH
+    snap = ((timer[TIMER_SNAPH] & 0xFFFF) << 16) | (timer[TIMER_SNAPL] & 0xFFFF);
+    return ~snap;  //the timer counts down, make it count up
+#endif
+}
+
+uint32_t prof_freq(void)
+{
+#ifdef PROF_USE_HAL_TIMESTAMP
+    return (uint32_t)alt_timestamp_freq();
+#else
+    return (uint32_t)TIMER_FREQ;  //interval timer clock, see nios2_profile.h
+#endif
+}
+
+void prof_reset(struct prof_timer *t)
+{
+    t->start = 0;
+    t->last = 0;
+    t->min = 0xFFFFFFFF;
+    t->max = 0;
+    t->count = 0;
+    t->total = 0;
+}
+
+void prof_start(struct prof_timer *t)
+{
+    t->start = prof_now();
+}
+
+uint32_t prof_stop(struct prof_timer *t)
+{
+    uint32_t end = prof_now();
+    uint32_t ticks = end - t->start;  //unsigned subtraction, correct across one wraparound
+
+    ticks = (ticks > prof_overhead) ? ticks - prof_overhead : 0;
+    t->last = ticks;
+    t->total += ticks;
+    t->count++;
+    if (ticks < t->min)
+    {
+        t->min = ticks;
+    }
+    if (ticks > t->max)
+    {
+        t->max = ticks;
+    }
+    return ticks;
+}
+
+uint32_t prof_average(const struct prof_timer *t)
+{
+    if (t->count == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)((t->total + t->count / 2) / t->count);
+}
+
+uint32_t prof_ratio_x100(const struct prof_timer *num, const struct prof_timer *den)
+{
+    if (den->total == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)((num->total * 100 + den->total / 2) / den->total);
+}
+
+void prof_print(const char *name, const struct prof_timer *t)
+{
+    //32-bit printf arguments only, the small C library of the BSP has no %llu
+    printf("%s: avg %u, min %u, max %u cycles over %u runs\n", name,
+           (unsigned)prof_average(t), (unsigned)((t->count == 0) ? 0 : t->min), (unsigned)t->max, (unsigned)t->count);
+}
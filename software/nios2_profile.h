@@ -0,0 +1,80 @@
+//Cycle profiling for the Nios II benchmarks: start/stop/elapsed with 64-bit totals over many iterations
+//Two backends:
+//  default                 – the DE1-SoC interval timer at TIMER_BASE, run free (continuous mode, full 32-bit period)
+//  -DPROF_USE_HAL_TIMESTAMP – the HAL timestamp driver (sys/alt_timestamp.h, e.g. a performance counter or a
+//                            timer core selected as timestamp timer in the BSP)
+//Both count clock ticks upwards; one start/stop interval is computed modulo 2^32, so it is exact across
+//counter wraparound as long as a single interval is shorter than 2^32 ticks (about 43 s at 100 MHz).
+//The cost of a start/stop pair itself is measured by prof_init() and subtracted from every interval.
+#ifndef NIOS2_PROFILE_H
+#define NIOS2_PROFILE_H
+
+#include <stdint.h>
+#include "system.h"  //BSP settings: INTERVAL_TIMER_FREQ, ALT_CPU_FREQ
+
+//NIOS II Interval Timer Base Address (from Platform Designer)
+#ifndef TIMER_BASE
+#define TIMER_BASE 0xFF202000
+#endif
+
+//Clock of the interval timer in Hz, used by prof_freq() for rates: -DTIMER_FREQ=<Hz>, else the frequency
+//system.h gives the DE1-SoC Computer's Interval_Timer, else the CPU clock (the timer usually runs on it),
+//else 100 MHz; a timer with another component name needs -DTIMER_FREQ=<name>_FREQ
+#ifndef TIMER_FREQ
+#if defined(INTERVAL_TIMER_FREQ)
+#define TIMER_FREQ INTERVAL_TIMER_FREQ
+#elif defined(ALT_CPU_FREQ)
+#define TIMER_FREQ ALT_CPU_FREQ
+#else
+#define TIMER_FREQ 100000000u
+#endif
+#endif
+
+//Interval timer registers (16-bit halves of the 32-bit period and snapshot)
+#define TIMER_STATUS 0
+#define TIMER_CONTROL 1
+#define TIMER_PERIODL 2
+#define TIMER_PERIODH 3
+#define TIMER_SNAPL 4
+#define TIMER_SNAPH 5
+#define TIMER_CONTROL_CONT 0x2   //reload at zero and keep counting
+#define TIMER_CONTROL_START 0x4
+
+//start/stop pairs measured by prof_init() to find the overhead
+#define PROF_CALIBRATE_RUNS 16
+
+struct prof_timer
+{
+    uint32_t start;  //tick count at prof_start()
+    uint32_t last;   //last interval, overhead subtracted
+    uint32_t min;    //shortest interval
+    uint32_t max;    //longest interval
+    uint32_t count;  //intervals accumulated
+    uint64_t total;  //sum of all intervals
+};
+
+extern uint32_t prof_overhead;  //ticks of an empty start/stop pair, from prof_init()
+
+//Starts the counter and calibrates prof_overhead, call once before any measurement
+void prof_init(void);
+
+//Current tick count, counting up
+uint32_t prof_now(void);
+
+//Ticks per second of the selected counter (0 if the HAL does not know it)
+uint32_t prof_freq(void);
+
+void prof_reset(struct prof_timer *t);
+void prof_start(struct prof_timer *t);
+uint32_t prof_stop(struct prof_timer *t);  //returns the interval, and adds it to the totals
+
+//Average interval, rounded
+uint32_t prof_average(const struct prof_timer *t);
+
+//Ratio of two totals in hundredths, rounded (e.g. 1234 = 12.34x), 0 if den has no ticks
+uint32_t prof_ratio_x100(const struct prof_timer *num, const struct prof_timer *den);
+
+//Prints "name: avg A, min B, max C cycles over N runs"
+void prof_print(const char *name, const struct prof_timer *t);
+
+#endif